@@ -20,7 +20,14 @@
 #include "gash.hh"
 #include "../res/funcs.hh"
 #include "../gc/tcp.hh"
+#include "../gc/aes.hh"
+#include <condition_variable>
+#include <csignal>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
 
 using std::ofstream;
 using std::fputs;
@@ -32,7 +39,19 @@ using gashgc::tcp_server_init2;
 using gashgc::tcp_client_init;
 using gashgc::tcp_send_mpz;
 using gashgc::tcp_recv_mpz;
+using gashgc::tcp_send_mpz_vec;
+using gashgc::tcp_recv_mpz_vec;
+using gashgc::tcp_send_u64_vec;
+using gashgc::tcp_recv_u64_vec;
 using gashlang::set_ofstream;
+using gashgc::build_circuit;
+using gashgc::block;
+using gashgc::IdVec;
+using gashgc::IdLabelMap;
+using gashgc::xor_block;
+using gashgc::get_lsb;
+using gashgc::tcp_send_bytes;
+using gashgc::tcp_recv_bytes;
 
 static mpz_class m_config_l;
 static mpz_class m_config_l_1;
@@ -57,8 +76,67 @@ static ofstream m_data_stream;
 
 static stack<triplet_t> m_tri_stack;
 
+/// Compiled circuits, by registry name, bit size and hash of the instantiated source
+static map<circ_cache_key_t, circ_cache_entry_t> m_circ_cache;
+static u64 m_cache_hit = 0;
+static u64 m_cache_miss = 0;
+
 static gmp_randclass gmp_prn(gmp_randinit_default);
 
+static bool dealer_take(ring_triplet_t& tri);
+static size_t ring_trunc_left();
+static vector<ring_t> ring_mul_rescale_batch(const vector<ring_t>& a, const vector<ring_t>& b,
+                                             const vector<ring_triplet_t>& tri);
+
+/**
+ * The ring element a share stands for, x mod 2^CONFIG_L
+ *
+ */
+static inline ring_t mpz_ring(const mpz_class& x)
+{
+    ring_t v = mpz_get_ui(x.get_mpz_t());
+    return mpz_sgn(x.get_mpz_t()) < 0 ? -v : v;
+}
+
+/**
+ * A share as a circuit input, the same value mod 2^CONFIG_L within what the
+ * lexer reads with atoll. Shares in [2^63, 2^64) would saturate otherwise
+ *
+ */
+static inline string mpz_input_str(const mpz_class& x)
+{
+    return std::to_string((i64)mpz_ring(x));
+}
+
+/**
+ * A seed from the system entropy source. random_block is a time-seeded LCG
+ * shared by all threads, fine for labels in tests but not for keys
+ *
+ */
+static gashgc::block seed_block()
+{
+    std::random_device rd;
+    u32 w[4];
+
+    for (u32 i = 0; i < 4; ++i) {
+        w[i] = rd();
+    }
+    return _mm_set_epi32(w[3], w[2], w[1], w[0]);
+}
+
+/**
+ * A random block, AES-128 in counter mode under a key from seed_block. Each
+ * thread keys its own stream on first use
+ *
+ */
+static gashgc::block prg_block()
+{
+    static thread_local gashgc::FixedKeyAES aes(seed_block());
+    static thread_local u64 ctr = 0;
+
+    return aes.encrypt128(_mm_set_epi64x(0, ctr++));
+}
+
 int gash_config_init()
 {
     mpz_class one = 1;
@@ -86,88 +164,301 @@ static int set_random_file()
     return 0;
 }
 
-static int exec_asym(string circ_src, string data_src)
+/**
+ * Compile `name` at `bitsize` bits, or fetch it from the cache. Only a miss
+ * parses the source, which also writes the data file for `data`
+ *
+ * @param name
+ * @param bitsize
+ * @param data Input directives, name and decimal value
+ * @param entry
+ *
+ * @return 0 if success, otherwise errno is returned
+ */
+static int load_circ(string name, u32 bitsize, const NameValVec& data, circ_cache_entry_t*& entry)
 {
-    // Asymmetric execution, meaning that only the evaluator gets the output
-    // Write circuit and data to a temporary file
     extern FILE* yyin;
-    yyin = std::tmpfile();
-    if (m_id == 0) {
-        yyin = fopen("./g_file", "w+");
-    } else {
-        yyin = fopen("./e_file", "w+");
+    string circ_src;
+    string data_src;
+    char cname[128];
+
+    REQUIRE_GOOD_STATUS(LOAD_CIRCUIT(name, bitsize, circ_src));
+
+    // The source is part of the key, re-registering a function invalidates it
+    circ_cache_key_t key(name, bitsize, std::hash<string>()(circ_src));
+    auto it = m_circ_cache.find(key);
+    if (it != m_circ_cache.end()) {
+        m_cache_hit++;
+        entry = &it->second;
+        return 0;
     }
+    m_cache_miss++;
+
+    for (auto& in : data) {
+        LOAD_DATA(in.first, in.second, data_src);
+    }
+
+    std::tmpnam(cname);
+    ofstream circ_stream(cname, std::ios::out | std::ios::trunc | std::ios::binary);
+    ofstream data_stream(m_dname, std::ios::out | std::ios::trunc);
+
+    gashlang::parse_clean();
+    set_ofstream(circ_stream, data_stream);
+    gashlang::set_binary_circuit(true);
+
+    yyin = std::tmpfile();
     fputs(circ_src.c_str(), yyin);
     fputs(data_src.c_str(), yyin);
     rewind(yyin);
-    yyparse();
+    int parse_result = yyparse();
+    fclose(yyin);
+    circ_stream.close();
+    data_stream.close();
+
+    if (parse_result != 0) {
+        WARNING("Unable to compile circuit " << name);
+        return -G_EINVAL;
+    }
+
+    circ_cache_entry_t& e = m_circ_cache[key];
+    e.m_circ_fpath = cname;
+    e.m_layout = gashlang::get_input_layout();
+    REQUIRE_GOOD_STATUS(build_circuit(e.m_circ_fpath, e.m_fc));
+
+    entry = &e;
+    return 0;
+}
+
+/**
+ * Output labels of the last run, split into its `n` instances. A constant
+ * output has no label, the garbler makes one up and sends the evaluator the
+ * one of the constant
+ *
+ * @param n
+ * @param out
+ *
+ * @return 0 if success, otherwise errno is returned
+ */
+static int get_out_lbls(u32 n, vector<yshare_t>& out)
+{
+    gashgc::FlatCircuit& fc = m_id == 0 ? m_garbler->m_fc : m_evaluator->m_fc;
+    gashgc::FlatGarbledCircuit& fgc = m_id == 0 ? m_garbler->m_fgc : m_evaluator->m_fgc;
+    int sock = m_id == 0 ? m_garbler->m_peer_sock : m_evaluator->m_peer_sock;
+    IdVec& ids = fc.m_out_id_vec;
+    u32 len = ids.size() / n;
+    vector<block> consts;
+    vector<u32> const_pos;
+
+    out.assign(n, yshare_t(len));
+    for (u32 i = 0; i < ids.size(); i++) {
+        block& lbl = out[i / len][i % len];
+        auto it = fc.m_out_const_map.find(ids[i]);
+        if (it == fc.m_out_const_map.end()) {
+            REQUIRE_GOOD_STATUS(fgc.get_lbl(fc, ids[i], 0, lbl));
+        } else if (m_id == 0) {
+            lbl = prg_block();
+            consts.push_back(it->second ? xor_block(lbl, fgc.m_R) : lbl);
+        } else {
+            const_pos.push_back(i);
+        }
+    }
+
+    if (m_id == 0 && !consts.empty()) {
+        REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, (char*)consts.data(), consts.size() * LABELSIZE));
+    } else if (m_id == 1 && !const_pos.empty()) {
+        consts.resize(const_pos.size());
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, (char*)consts.data(), consts.size() * LABELSIZE));
+        for (u32 i = 0; i < const_pos.size(); i++) {
+            out[const_pos[i] / len][const_pos[i] % len] = consts[i];
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Run a cached circuit on new input data, one instance per element of
+ * `data`. All instances are garbled as one replicated circuit, so they share
+ * a single table transfer and a single OT
+ *
+ * @param name
+ * @param bitsize
+ * @param data
+ * @param sym If set, the garbler gets the output too
+ * @param yin Inputs given as garbled shares, by directive name, one map per
+ *        instance. Both parties pass the same names
+ * @param yout If set, the outputs are kept as garbled shares, one per
+ *        instance, instead of being revealed
+ *
+ * @return 0 if success, otherwise errno is returned
+ */
+static int exec_circ(string name, u32 bitsize, const vector<NameValVec>& data, bool sym,
+                     const vector<NameYMap>* yin = NULL, vector<yshare_t>* yout = NULL)
+{
+    circ_cache_entry_t* entry;
+    gashgc::FlatCircuit* fc;
+    map<string, i64> vals;
+    u32 n = data.size();
+    NameValVec data0;
+    gashlang::InputLayout layout;
+
+    GASSERT(n > 0);
+    GASSERT(!yin || yin->size() == n);
+
+    // Garbled inputs are parsed like inputs of our own, the layout then says
+    // which wires they are
+    data0 = data[0];
+    if (yin) {
+        for (auto& in : (*yin)[0]) {
+            data0.emplace_back(in.first, "0");
+        }
+    }
+    REQUIRE_GOOD_STATUS(load_circ(name, bitsize, data0, entry));
+
+    fc = &entry->m_fc;
+    if (n > 1) {
+        fc = &entry->m_batch_fc[n];
+        if (fc->m_ngate == 0) {
+            REQUIRE_GOOD_STATUS(gashgc::replicate_circuit(entry->m_fc, n, *fc));
+        }
+    }
+
+    // Instance k's wire ids are shifted by k * stride, the data file holds 2 * id
+    u32 stride = entry->m_fc.m_wire_idx.size();
+    IdLabelMap& in_lbl = m_id == 0 ? m_garbler->m_in_lbl_map : m_evaluator->m_in_lbl_map;
+    for (auto& in : entry->m_layout) {
+        if (!yin || in.m_var.empty() || (*yin)[0].count(in.m_var) == 0) {
+            layout.push_back(in);
+            continue;
+        }
+
+        // The wire carries the bit xor m_val, the garbler's label of 0 follows
+        for (u32 k = 0; k < n; k++) {
+            block lbl = (*yin)[k].at(in.m_var)[in.m_bit];
+            if (m_id == 0 && in.m_val) {
+                lbl = xor_block(lbl, m_garbler->m_fgc.m_R);
+            }
+            in_lbl[(in.m_id + 2 * k * stride) / 2] = lbl;
+        }
+    }
+
+    ofstream data_stream(m_dname, std::ios::out | std::ios::trunc);
+    for (u32 k = 0; k < n; k++) {
+
+        // Same conversion as the lexer applies to #definput values
+        vals.clear();
+        for (auto& in : data[k]) {
+            vals[in.first] = atoll(in.second.c_str());
+        }
+
+        REQUIRE_GOOD_STATUS(gashlang::write_input(layout, vals, data_stream, 2 * k * stride));
+    }
+    data_stream.close();
 
     if (m_id == 0)
     {
-        m_garbler->build_circ();
+        m_garbler->m_circ_fpath = entry->m_circ_fpath;
+        m_garbler->m_input_fpath = m_dname;
+        m_garbler->m_fc = *fc;
         m_garbler->read_input();
         m_garbler->garble_circ();
         m_garbler->send_egtt();
         m_garbler->send_peer_lbls();
         m_garbler->send_self_lbls();
-        m_garbler->send_output_map();
+        if (!yout) {
+            m_garbler->send_output_map();
+        }
+        if (sym) {
+            m_garbler->recv_output();
+        }
 
     } else
     {
-        m_evaluator->build_circ();
+        m_evaluator->m_circ_fpath = entry->m_circ_fpath;
+        m_evaluator->m_input_fpath = m_dname;
+        m_evaluator->m_fc = *fc;
         m_evaluator->read_input();
         m_evaluator->build_garbled_circuit();
         m_evaluator->recv_egtt();
         m_evaluator->recv_self_lbls();
         m_evaluator->recv_peer_lbls();
         m_evaluator->evaluate_circ();
-        m_evaluator->recv_output_map();
-        m_evaluator->recover_output();
+        if (!yout) {
+            m_evaluator->recv_output_map();
+            m_evaluator->recover_output();
+        }
+        if (sym) {
+            m_evaluator->send_output();
+        }
+    }
+
+    if (yout) {
+        REQUIRE_GOOD_STATUS(get_out_lbls(n, *yout));
     }
 
     return 0;
 }
 
-static int exec_sym(string circ_src, string data_src)
+static int exec_asym(string name, u32 bitsize, const vector<NameValVec>& data)
 {
-    extern FILE* yyin;
-    yyin = std::tmpfile();
+    // Asymmetric execution, meaning that only the evaluator gets the output
+    return exec_circ(name, bitsize, data, false);
+}
+
+static int exec_sym(string name, u32 bitsize, const vector<NameValVec>& data)
+{
+    return exec_circ(name, bitsize, data, true);
+}
+
+/**
+ * Split the output of the last run into its `n` instances, most significant
+ * bit first as get_output gives them
+ *
+ * @param n
+ * @param outs
+ */
+static void get_outputs(u32 n, vector<string>& outs)
+{
+    string out_str;
+    u32 len;
+
     if (m_id == 0) {
-        yyin = fopen("./g_file", "w+");
+        m_garbler->get_output(out_str);
     } else {
-        yyin = fopen("./e_file", "w+");
+        m_evaluator->get_output(out_str);
     }
-    fputs(circ_src.c_str(), yyin);
-    fputs(data_src.c_str(), yyin);
-    rewind(yyin);
-    yyparse();
 
-    if (m_id == 0)
-    {
-        m_garbler->build_circ();
-        m_garbler->read_input();
-        m_garbler->garble_circ();
-        m_garbler->send_egtt();
-        m_garbler->send_peer_lbls();
-        m_garbler->send_self_lbls();
-        m_garbler->send_output_map();
-        m_garbler->recv_output();
+    // get_output reverses the outputs, the last instance comes first
+    len = out_str.size() / n;
+    outs.resize(n);
+    for (u32 k = 0; k < n; k++) {
+        outs[k] = out_str.substr((n - 1 - k) * len, len);
+    }
+}
 
-    } else
-    {
-        m_evaluator->build_circ();
-        m_evaluator->read_input();
-        m_evaluator->build_garbled_circuit();
-        m_evaluator->recv_egtt();
-        m_evaluator->recv_self_lbls();
-        m_evaluator->recv_peer_lbls();
-        m_evaluator->evaluate_circ();
-        m_evaluator->recv_output_map();
-        m_evaluator->recover_output();
-        m_evaluator->send_output();
+static void reset_circ()
+{
+    if (m_id == 0) {
+        m_garbler->reset_circ();
+    } else {
+        m_evaluator->reset_circ();
     }
+}
 
-    return 0;
+int gash_circ_cache_stats(u64& hit, u64& miss)
+{
+    hit = m_cache_hit;
+    miss = m_cache_miss;
+    return m_circ_cache.size();
+}
+
+void gash_circ_cache_clear()
+{
+    for (auto& it : m_circ_cache) {
+        remove(it.second.m_circ_fpath.c_str());
+    }
+    m_circ_cache.clear();
+    m_cache_hit = m_cache_miss = 0;
 }
 
 int gash_init_as_garbler(string peer_ip)
@@ -197,10 +488,32 @@ int gash_connect_peer()
     return 0;
 }
 
+int gash_ot_precompute(u32 n, u32 batch)
+{
+    if (m_id == 0) {
+        return m_garbler->start_ot_pool(n, batch);
+    } else {
+        return m_evaluator->start_ot_pool(n, batch);
+    }
+}
+
+int gash_ot_pool_stats(gashgc::OTPoolStats& stats)
+{
+    gashgc::OTPool* pool = m_id == 0 ? m_garbler->m_ot_pool : m_evaluator->m_ot_pool;
+
+    if (!pool) {
+        return -G_ENOENT;
+    }
+    stats = pool->stats();
+    return 0;
+}
+
 int gash_ss_garbler_init(string client_ip)
 {
-    REQUIRE_GOOD_STATUS(tcp_server_init(GASH_SS_PORT, m_ss_listen_sock, m_ss_peer_sock));
-    return tcp_client_init(client_ip, GASH_SS_CLIENT_PORT, m_ss_client_sock);
+    // The client takes the first connection as party 0's, make sure it is
+    // ours before the evaluator can get past us
+    REQUIRE_GOOD_STATUS(tcp_client_init(client_ip, GASH_SS_CLIENT_PORT, m_ss_client_sock));
+    return tcp_server_init(GASH_SS_PORT, m_ss_listen_sock, m_ss_peer_sock);
 }
 
 int gash_ss_evaluator_init(string client_ip, string peer_ip)
@@ -231,6 +544,33 @@ int gash_ss_recon_p2p(mpz_class share, mpz_class& ret)
     return 0;
 }
 
+/**
+ * Open every share in one exchange, the opened values are in [0, 2^CONFIG_L)
+ *
+ */
+int gash_ss_recon_p2p_batch(const vector<mpz_class>& shares, vector<mpz_class>& ret)
+{
+    if (m_id == 0)
+    {
+        REQUIRE_GOOD_STATUS(tcp_send_mpz_vec(m_ss_peer_sock, shares, CONFIG_L));
+        REQUIRE_GOOD_STATUS(tcp_recv_mpz_vec(m_ss_peer_sock, ret, CONFIG_L));
+    } else {
+        REQUIRE_GOOD_STATUS(tcp_recv_mpz_vec(m_ss_peer_sock, ret, CONFIG_L));
+        REQUIRE_GOOD_STATUS(tcp_send_mpz_vec(m_ss_peer_sock, shares, CONFIG_L));
+    }
+
+    if (ret.size() != shares.size()) {
+        WARNING("Peer opened " << ret.size() << " shares, expected " << shares.size());
+        return -G_EINVAL;
+    }
+
+    for (u32 i = 0; i < ret.size(); ++i) {
+        ret[i] += shares[i];
+        mpz_fdiv_r_2exp(ret[i].get_mpz_t(), ret[i].get_mpz_t(), CONFIG_L);
+    }
+    return 0;
+}
+
 int gash_ss_recon_slave(mpz_class& share)
 {
     string share_str = share.get_str(10);
@@ -245,10 +585,12 @@ int gash_ss_recon_master(mpz_class& ret)
     REQUIRE_GOOD_STATUS(tcp_recv_mpz(m_ss_p0_sock, share0));
     REQUIRE_GOOD_STATUS(tcp_recv_mpz(m_ss_p1_sock, share1));
     ret = share0 + share1;
-    ret %= m_config_l;
-    if (mpz_cmp(ret.get_mpz_t(), m_config_l_1.get_mpz_t()) > 0)
+    mpz_fdiv_r_2exp(ret.get_mpz_t(), ret.get_mpz_t(), CONFIG_L);
+
+    // The upper half of the ring holds the negative values
+    if (mpz_cmp(ret.get_mpz_t(), m_config_l_1.get_mpz_t()) >= 0)
     {
-        ret = m_config_l - ret;
+        ret -= m_config_l;
     }
     return 0;
 }
@@ -278,6 +620,32 @@ int gash_ss_recv_share(mpz_class& share)
     return 0;
 }
 
+/**
+ * Share every element of `xs` in one message per party. Shares go out as
+ * CONFIG_L-bit ring elements, the receivers get representatives in
+ * [0, 2^CONFIG_L)
+ *
+ */
+int gash_ss_send_shares(const vector<mpz_class>& xs)
+{
+    vector<mpz_class> share0(xs.size());
+    vector<mpz_class> share1(xs.size());
+
+    for (u32 i = 0; i < xs.size(); ++i) {
+        share0[i] = gmp_prn.get_z_bits(CONFIG_L - 1);
+        share1[i] = xs[i] - share0[i];
+    }
+
+    REQUIRE_GOOD_STATUS(tcp_send_mpz_vec(m_ss_p0_sock, share0, CONFIG_L));
+    REQUIRE_GOOD_STATUS(tcp_send_mpz_vec(m_ss_p1_sock, share1, CONFIG_L));
+    return 0;
+}
+
+int gash_ss_recv_shares(vector<mpz_class>& shares)
+{
+    return tcp_recv_mpz_vec(m_ss_client_sock, shares, CONFIG_L);
+}
+
 int gash_ss_rescale_p2p(mpz_class& x)
 {
     mpz_class rescale_r;
@@ -314,8 +682,52 @@ int gash_ss_rescale_p2p(mpz_class& x)
     return 0;
 }
 
-// TODO: make this a macro if it works
-mpz_class gash_ss_relu(mpz_class x)
+/**
+ * Run a masked single-input circuit (ss_relu, ss_relugrad) on every share in
+ * `x`. The garbler masks every output with a fresh r and keeps r as its share,
+ * the evaluator gets output - r
+ *
+ */
+static vector<mpz_class> exec_masked_batch(string name, vector<mpz_class>& x)
+{
+    vector<NameValVec> data(x.size());
+    vector<mpz_class> ret(x.size());
+    vector<string> outs;
+    mpz_class r;
+
+    if (x.empty()) {
+        return ret;
+    }
+
+    for (u32 k = 0; k < x.size(); k++) {
+        if (m_id == 0) {
+            r = gmp_prn.get_z_bits(CONFIG_L - 1);
+            ret[k] = r;
+            data[k].emplace_back("in0", mpz_input_str(x[k]));
+            data[k].emplace_back("r", r.get_str(10));
+        }
+        else if (m_id == 1) {
+            data[k].emplace_back("in1", mpz_input_str(x[k]));
+        }
+        else {
+            FATAL("Invalid id, must be 0 or 1");
+        }
+    }
+
+    exec_asym(name, CONFIG_L, data);
+
+    if (m_id == 1) {
+        get_outputs(x.size(), outs);
+        for (u32 k = 0; k < x.size(); k++) {
+            mpz_set_str(ret[k].get_mpz_t(), outs[k].c_str(), 2);
+        }
+    }
+    reset_circ();
+
+    return ret;
+}
+
+vector<mpz_class> gash_ss_relu_batch(vector<mpz_class>& x)
 {
     //////////////// No longer needed since circuit value will wrap around automatically //////////
     // 1) test if asb(x) is larger than half the ring
@@ -329,86 +741,106 @@ mpz_class gash_ss_relu(mpz_class x)
     // }
     /////////////////////////////////////////////////////////////////////////////////////////////
 
-    // 2) convert x to decimal string
-    mpz_class r;
-    mpz_class ret;
-    string circ_src;
-    string data_src;
-    string output;
-    string x_str = x.get_str(10);
-    string r_str;
-
-    // 3) load relu circuit and evaluate it
-    LOAD_CIRCUIT("ss_relu", CONFIG_L, circ_src);
-
-    if (m_id == 0) {
-        r = gmp_prn.get_z_bits(CONFIG_L - 1);
-        r_str = r.get_str(10);
-        LOAD_DATA("in0", x_str, data_src);
-        LOAD_DATA("r", r_str, data_src);
-    }
-    else if (m_id == 1) {
-        LOAD_DATA("in1", x_str, data_src);
-    }
-    else {
-        FATAL("Invalid id, must be 0 or 1");
-    }
-
-    exec_asym(circ_src, data_src);
+    return exec_masked_batch("ss_relu", x);
+}
 
-    // 4) build a mpz_class from the output string
-    if (m_id == 0) {
-        mpz_set_str(ret.get_mpz_t(), r_str.c_str(), 10);
-        m_garbler->reset_circ();
-    } else {
-        string out_str;
-        m_evaluator->get_output(out_str);
-        mpz_set_str(ret.get_mpz_t(), out_str.c_str(), 2);
-        m_evaluator->reset_circ();
-    }
+vector<mpz_class> gash_ss_relugrad_batch(vector<mpz_class>& x)
+{
+    return exec_masked_batch("ss_relu_grad", x);
+}
 
-    return ret;
+mpz_class gash_ss_relu(mpz_class x)
+{
+    vector<mpz_class> xs(1, x);
+    return gash_ss_relu_batch(xs)[0];
 }
 
 mpz_class gash_ss_relugrad(mpz_class x)
 {
+    vector<mpz_class> xs(1, x);
+    return gash_ss_relugrad_batch(xs)[0];
+}
 
-    // 2) convert x to decimal string
-    mpz_class r;
-    mpz_class ret;
-    string circ_src;
-    string data_src;
-    string output;
-    string x_str = x.get_str(10);
-    string r_str;
+/**
+ * This party's share of a * b from the opened e = a - u, f = b - v
+ *
+ */
+static mpz_class beaver_share(const mpz_class& a, const mpz_class& b, const mpz_class& e,
+                              const mpz_class& f, const triplet_t& tri)
+{
+    mpz_class ci = f * a + e * b + tri.m_z;
+    if (m_id == 1)
+        ci -= e * f;
+    mpz_fdiv_r_2exp(ci.get_mpz_t(), ci.get_mpz_t(), CONFIG_L);
+    return ci;
+}
 
-    // 3) load relu circuit and evaluate it
-    LOAD_CIRCUIT("ss_relu_grad", CONFIG_L, circ_src);
+vector<mpz_class> gash_ss_mul_batch(const vector<mpz_class>& a, const vector<mpz_class>& b)
+{
+    GASSERT(a.size() == b.size());
+
+    u32 n = a.size();
+    vector<triplet_t> tri(n);
+    vector<mpz_class> ef(2 * n);
+    vector<mpz_class> opened;
+    vector<mpz_class> ret(n);
+
+    // 1), 2) One triplet each, e and f of all of them go out together
+    for (u32 i = 0; i < n; ++i) {
+        tri[i] = gash_ss_get_next_triplet();
+        ef[2 * i] = a[i] - tri[i].m_u;
+        ef[2 * i + 1] = b[i] - tri[i].m_v;
+    }
 
-    if (m_id == 0) {
-        r = gmp_prn.get_z_bits(CONFIG_L - 1);
-        r_str = r.get_str(10);
-        LOAD_DATA("in0", x_str, data_src);
-        LOAD_DATA("r", r_str, data_src);
+    // 3)
+    if (gash_ss_recon_p2p_batch(ef, opened) < 0) {
+        FATAL("Failed to open e and f");
     }
-    else if (m_id == 1) {
-        LOAD_DATA("in1", x_str, data_src);
+
+    // 4)
+    for (u32 i = 0; i < n; ++i) {
+        ret[i] = beaver_share(a[i], b[i], opened[2 * i], opened[2 * i + 1], tri[i]);
     }
-    else {
-        FATAL("Invalid id, must be 0 or 1");
+
+    return ret;
+}
+
+/**
+ * Multiply and rescale as gash_ring_mul_rescale_batch does, on the ring
+ * elements the shares and the triplets stand for. Without enough truncation
+ * pairs for the batch, every product is rescaled by gash_ss_rescale_p2p
+ *
+ */
+vector<mpz_class> gash_ss_mul_rescale_batch(const vector<mpz_class>& a, const vector<mpz_class>& b)
+{
+    GASSERT(a.size() == b.size());
+
+    u32 n = a.size();
+    vector<ring_t> ar(n);
+    vector<ring_t> br(n);
+    vector<ring_triplet_t> tri(n);
+    vector<mpz_class> ret(n);
+    triplet_t t;
+
+    // Both parties were dealt the same pairs, so they take the same branch
+    if (ring_trunc_left() < n) {
+        ret = gash_ss_mul_batch(a, b);
+        for (u32 i = 0; i < n; ++i) {
+            gash_ss_rescale_p2p(ret[i]);
+        }
+        return ret;
     }
 
-    exec_asym(circ_src, data_src);
+    for (u32 i = 0; i < n; ++i) {
+        t = gash_ss_get_next_triplet();
+        tri[i] = {mpz_ring(t.m_u), mpz_ring(t.m_v), mpz_ring(t.m_z)};
+        ar[i] = mpz_ring(a[i]);
+        br[i] = mpz_ring(b[i]);
+    }
 
-    // 4) build a mpz_class from the output string
-    if (m_id == 0) {
-        mpz_set_str(ret.get_mpz_t(), r_str.c_str(), 10);
-        m_garbler->reset_circ();
-    } else {
-        string out_str;
-        m_evaluator->get_output(out_str);
-        mpz_set_str(ret.get_mpz_t(), out_str.c_str(), 2);
-        m_evaluator->reset_circ();
+    vector<ring_t> c = ring_mul_rescale_batch(ar, br, tri);
+    for (u32 i = 0; i < n; ++i) {
+        ret[i] = mpz_class(c[i]);
     }
 
     return ret;
@@ -416,116 +848,412 @@ mpz_class gash_ss_relugrad(mpz_class x)
 
 mpz_class gash_ss_mul(mpz_class a, mpz_class b)
 {
-    mpz_class ei, fi, e, f, ci;
+    vector<mpz_class> as(1, a);
+    vector<mpz_class> bs(1, b);
+    return gash_ss_mul_batch(as, bs)[0];
+}
 
-    // 1) Get a triplet
-    triplet_t tri = gash_ss_get_next_triplet();
-    gmp_printf("tri.m_u: %Zd\n", tri.m_u);
-    gmp_printf("tri.m_v; %Zd\n", tri.m_v);
-    gmp_printf("tri.m_z; %Zd\n", tri.m_z);
+vector<int> gash_ss_la_batch(vector<mpz_class>& a, vector<mpz_class>& b)
+{
+    GASSERT(a.size() == b.size());
 
-    // 2)
-    ei = a - tri.m_u;
-    fi = b - tri.m_v;
+    vector<NameValVec> data(a.size());
+    vector<int> ret(a.size());
+    vector<string> outs;
+    mpz_class out;
 
-    // 3)
-    gash_ss_recon_p2p(ei, e);
-    gash_ss_recon_p2p(fi, f);
+    if (a.empty()) {
+        return ret;
+    }
 
-    // 4)
-    if (m_id == 0)
-        ci = f * a + e * b + tri.m_z;
-    else
-        ci = - e * f + f * a + e * b + tri.m_z;
+    for (u32 k = 0; k < a.size(); k++) {
+        if (m_id == 0) {
+            data[k].emplace_back("a0", mpz_input_str(a[k]));
+            data[k].emplace_back("b0", mpz_input_str(b[k]));
+        }
+        else if (m_id == 1) {
+            data[k].emplace_back("a1", mpz_input_str(a[k]));
+            data[k].emplace_back("b1", mpz_input_str(b[k]));
+        }
+        else {
+            FATAL("Invalid id, must be 0 or 1");
+        }
+    }
 
-    gmp_printf("ci = %Zd\n", ci);
+    exec_sym("ss_la", CONFIG_L, data);
 
-    return ci;
+    get_outputs(a.size(), outs);
+    for (u32 k = 0; k < a.size(); k++) {
+        mpz_set_str(out.get_mpz_t(), outs[k].c_str(), 2);
+        ret[k] = mpz_get_si(out.get_mpz_t());
+    }
+    reset_circ();
+
+    return ret;
 }
 
-int gash_ss_la(mpz_class a, mpz_class b)
+vector<mpz_class> gash_ss_div_batch(vector<mpz_class>& a, vector<mpz_class>& b)
 {
-    mpz_class ret;
-    string circ_src;
-    string data_src;
-    string output;
-    string a_str = a.get_str(10);
-    string b_str = b.get_str(10);
+    GASSERT(a.size() == b.size());
 
-    // 3) load relu circuit and evaluate it
-    LOAD_CIRCUIT("ss_la", CONFIG_L, circ_src);
+    vector<NameValVec> data(a.size());
+    vector<mpz_class> ret(a.size());
+    vector<string> outs;
+    mpz_class r;
 
-    if (m_id == 0) {
-        LOAD_DATA("a0", a_str, data_src);
-        LOAD_DATA("b0", b_str, data_src);
+    if (a.empty()) {
+        return ret;
     }
-    else if (m_id == 1) {
-        LOAD_DATA("a1", a_str, data_src);
-        LOAD_DATA("b1", b_str, data_src);
-    }
-    else {
-        FATAL("Invalid id, must be 0 or 1");
+
+    for (u32 k = 0; k < a.size(); k++) {
+        if (m_id == 0) {
+            r = gmp_prn.get_z_bits(CONFIG_L - 1);
+            ret[k] = r;
+            data[k].emplace_back("r", r.get_str(10));
+            data[k].emplace_back("a0", mpz_input_str(a[k]));
+            data[k].emplace_back("b0", mpz_input_str(b[k]));
+        }
+        else if (m_id == 1) {
+            data[k].emplace_back("a1", mpz_input_str(a[k]));
+            data[k].emplace_back("b1", mpz_input_str(b[k]));
+        }
+        else {
+            FATAL("Invalid id, must be 0 or 1");
+        }
     }
 
-    exec_sym(circ_src, data_src);
+    exec_asym("ss_div", CONFIG_L, data);
 
-    // 4) build a mpz_class from the output string
-    string out_str;
-    if (m_id == 0) {
-        m_garbler->get_output(out_str);
-        mpz_set_str(ret.get_mpz_t(), out_str.c_str(), 2);
-        m_garbler->reset_circ();
-    } else {
-        m_evaluator->get_output(out_str);
-        mpz_set_str(ret.get_mpz_t(), out_str.c_str(), 2);
-        m_evaluator->reset_circ();
+    if (m_id == 1) {
+        get_outputs(a.size(), outs);
+        for (u32 k = 0; k < a.size(); k++) {
+            mpz_set_str(ret[k].get_mpz_t(), outs[k].c_str(), 2);
+        }
     }
+    reset_circ();
 
-    return mpz_get_si(ret.get_mpz_t());
+    return ret;
 }
 
-mpz_class gash_ss_div(mpz_class a, mpz_class b)
+int gash_ss_la(mpz_class a, mpz_class b)
 {
+    vector<mpz_class> as(1, a);
+    vector<mpz_class> bs(1, b);
+    return gash_ss_la_batch(as, bs)[0];
+}
 
-    mpz_class r;
-    mpz_class ret;
-    string circ_src;
-    string data_src;
-    string output;
-    string r_str;
-    string a_str = a.get_str(10);
-    string b_str = b.get_str(10);
+mpz_class gash_ss_div(mpz_class a, mpz_class b)
+{
+    vector<mpz_class> as(1, a);
+    vector<mpz_class> bs(1, b);
+    return gash_ss_div_batch(as, bs)[0];
+}
+
+/*
+ * Garbled shares
+ */
 
-    // 3) load relu circuit and evaluate it
-    LOAD_CIRCUIT("ss_div", CONFIG_L, circ_src);
+static bool m_gc_session = false;
 
+void gash_gc_session_begin()
+{
+    // A fresh R, shares of an earlier session do not carry over
     if (m_id == 0) {
-        r = gmp_prn.get_z_bits(CONFIG_L - 1);
-        r_str = r.get_str(10);
-        LOAD_DATA("r", r_str, data_src);
-        LOAD_DATA("a0", a_str, data_src);
-        LOAD_DATA("b0", b_str, data_src);
+        m_garbler->m_keep_R = true;
+        m_garbler->m_R_drawn = false;
     }
-    else if (m_id == 1) {
-        LOAD_DATA("a1", a_str, data_src);
-        LOAD_DATA("b1", b_str, data_src);
+    m_gc_session = true;
+}
+
+void gash_gc_session_end()
+{
+    if (m_id == 0) {
+        m_garbler->m_keep_R = false;
+        m_garbler->m_R_drawn = false;
     }
-    else {
-        FATAL("Invalid id, must be 0 or 1");
+    m_gc_session = false;
+}
+
+/**
+ * Garbled shares only make sense within a session. The caller opens it, one
+ * opened here would never be closed and keep R for every later circuit
+ *
+ */
+static inline void gc_session_need()
+{
+    if (!m_gc_session) {
+        FATAL("Garbled shares need a session, call gash_gc_session_begin first");
     }
+}
 
-    exec_asym(circ_src, data_src);
+/// Tweaks of Y2A, counted in step by both parties. The upper word of a gate
+/// tweak is a u32 wire id, so they never meet
+static u64 m_y2a_count = 0;
+
+static inline ring_t y2a_hash(const gashgc::FixedKeyAES& aes, block lbl, block tweak)
+{
+    return (ring_t)_mm_cvtsi128_si64(aes.encrypt(lbl, _mm_setzero_si128(), tweak, _mm_setzero_si128()));
+}
+
+/**
+ * Y2A by decoding. For bit i the garbler sends H(L_b) + b 2^i - r_i for both
+ * b, ordered by the permute bit of L_b, and keeps the sum of the r_i. The
+ * evaluator can open only the ciphertext of its own label, the sum of what it
+ * opens is the other share
+ *
+ */
+static vector<ring_t> y2a(const vector<yshare_t>& y)
+{
+    vector<ring_t> ct;
+    vector<ring_t> ret(y.size(), 0);
+    u64 k = 0;
+    block tweak;
+    block lbl;
+    ring_t r;
+
+    for (auto& v : y) {
+        k += v.size();
+    }
+    if (k == 0) {
+        return ret;
+    }
 
-    // 4) build a mpz_class from the output string
-    string out_str;
     if (m_id == 0) {
-        mpz_set_str(ret.get_mpz_t(), r_str.c_str(), 10);
-        m_garbler->reset_circ();
+        const gashgc::FixedKeyAES& aes = m_garbler->m_aes;
+        block R = m_garbler->m_fgc.m_R;
+
+        ct.resize(2 * k);
+        k = 0;
+        for (u32 j = 0; j < y.size(); j++) {
+            for (u32 i = 0; i < y[j].size(); i++, k++) {
+                tweak = _mm_set_epi64x(~0ULL, m_y2a_count++);
+                lbl = y[j][i];
+                r = (ring_t)_mm_cvtsi128_si64(prg_block());
+                ct[2 * k + get_lsb(lbl)] = y2a_hash(aes, lbl, tweak) - r;
+                lbl = xor_block(lbl, R);
+                ct[2 * k + get_lsb(lbl)] = y2a_hash(aes, lbl, tweak) + ((ring_t)1 << i) - r;
+                ret[j] += r;
+            }
+        }
+
+        if (tcp_send_u64_vec(m_garbler->m_peer_sock, ct) < 0) {
+            FATAL("Failed to send Y2A ciphertexts");
+        }
     } else {
-        string out_str;
-        m_evaluator->get_output(out_str);
-        mpz_set_str(ret.get_mpz_t(), out_str.c_str(), 2);
-        m_evaluator->reset_circ();
+        const gashgc::FixedKeyAES& aes = m_evaluator->m_aes;
+
+        if (tcp_recv_u64_vec(m_evaluator->m_peer_sock, ct) < 0 || ct.size() != 2 * k) {
+            FATAL("Failed to receive Y2A ciphertexts");
+        }
+
+        k = 0;
+        for (u32 j = 0; j < y.size(); j++) {
+            for (u32 i = 0; i < y[j].size(); i++, k++) {
+                tweak = _mm_set_epi64x(~0ULL, m_y2a_count++);
+                lbl = y[j][i];
+                ret[j] += ct[2 * k + get_lsb(lbl)] - y2a_hash(aes, lbl, tweak);
+            }
+        }
+    }
+
+    return ret;
+}
+
+vector<yshare_t> gash_y_call_batch(string name, vector<NameYMap>& yin)
+{
+    vector<NameValVec> data(yin.size());
+    vector<yshare_t> ret;
+
+    if (yin.empty()) {
+        return ret;
+    }
+
+    gc_session_need();
+    if (exec_circ(name, CONFIG_L, data, false, &yin, &ret) < 0) {
+        FATAL("Failed to run " << name << " on garbled shares");
+    }
+    reset_circ();
+
+    return ret;
+}
+
+/**
+ * A2Y, add the shares in a garbled circuit and keep the sum garbled
+ *
+ */
+static vector<yshare_t> a2y(const vector<string>& x)
+{
+    vector<NameValVec> data(x.size());
+    vector<yshare_t> ret;
+
+    if (x.empty()) {
+        return ret;
+    }
+
+    for (u32 k = 0; k < x.size(); k++) {
+        data[k].emplace_back(m_id == 0 ? "a" : "b", x[k]);
+    }
+
+    gc_session_need();
+    if (exec_circ("add", CONFIG_L, data, false, NULL, &ret) < 0) {
+        FATAL("Failed to convert shares to garbled shares");
+    }
+    reset_circ();
+
+    return ret;
+}
+
+vector<yshare_t> gash_ss_a2y_batch(vector<mpz_class>& x)
+{
+    vector<string> strs(x.size());
+
+    for (u32 k = 0; k < x.size(); k++) {
+        strs[k] = mpz_input_str(x[k]);
+    }
+    return a2y(strs);
+}
+
+vector<mpz_class> gash_ss_y2a_batch(vector<yshare_t>& y)
+{
+    vector<ring_t> shares = y2a(y);
+    vector<mpz_class> ret(shares.size());
+
+    for (u32 k = 0; k < shares.size(); k++) {
+        mpz_import(ret[k].get_mpz_t(), 1, 1, sizeof(ring_t), 0, 0, &shares[k]);
+    }
+    return ret;
+}
+
+vector<yshare_t> gash_ring_a2y_batch(vector<ring_t>& x)
+{
+    vector<string> strs(x.size());
+
+    // Same value modulo 2^CONFIG_L, and within what the lexer reads
+    for (u32 k = 0; k < x.size(); k++) {
+        strs[k] = std::to_string((i64)x[k]);
+    }
+    return a2y(strs);
+}
+
+vector<ring_t> gash_ring_y2a_batch(vector<yshare_t>& y)
+{
+    return y2a(y);
+}
+
+vector<yshare_t> gash_y_relu_batch(vector<yshare_t>& x)
+{
+    vector<NameYMap> yin(x.size());
+
+    for (u32 k = 0; k < x.size(); k++) {
+        yin[k]["x"] = x[k];
+    }
+    return gash_y_call_batch("relu", yin);
+}
+
+vector<int> gash_y_la_batch(vector<yshare_t>& a, vector<yshare_t>& b)
+{
+    GASSERT(a.size() == b.size());
+
+    vector<NameValVec> data(a.size());
+    vector<NameYMap> yin(a.size());
+    vector<int> ret(a.size());
+    vector<string> outs;
+
+    if (a.empty()) {
+        return ret;
+    }
+
+    for (u32 k = 0; k < a.size(); k++) {
+        yin[k]["a"] = a[k];
+        yin[k]["b"] = b[k];
+    }
+
+    gc_session_need();
+    if (exec_circ("billionaire", CONFIG_L, data, true, &yin) < 0) {
+        FATAL("Failed to compare garbled shares");
+    }
+
+    get_outputs(a.size(), outs);
+    for (u32 k = 0; k < a.size(); k++) {
+        ret[k] = outs[k] == "1";
+    }
+    reset_circ();
+
+    return ret;
+}
+
+vector<yshare_t> gash_y_div_batch(vector<yshare_t>& a, vector<yshare_t>& b)
+{
+    GASSERT(a.size() == b.size());
+
+    vector<NameYMap> yin(a.size());
+
+    for (u32 k = 0; k < a.size(); k++) {
+        yin[k]["a"] = a[k];
+        yin[k]["b"] = b[k];
+    }
+    return gash_y_call_batch("div", yin);
+}
+
+vector<yshare_t> gash_y_gt_batch(vector<yshare_t>& a, vector<yshare_t>& b)
+{
+    GASSERT(a.size() == b.size());
+
+    vector<NameYMap> yin(a.size());
+
+    for (u32 k = 0; k < a.size(); k++) {
+        yin[k]["a"] = a[k];
+        yin[k]["b"] = b[k];
+    }
+    return gash_y_call_batch("billionaire", yin);
+}
+
+vector<yshare_t> gash_y_mux_batch(vector<yshare_t>& c, vector<yshare_t>& a, vector<yshare_t>& b)
+{
+    GASSERT(c.size() == a.size() && a.size() == b.size());
+
+    vector<NameYMap> yin(a.size());
+
+    for (u32 k = 0; k < a.size(); k++) {
+        yin[k]["c"] = c[k];
+        yin[k]["a"] = a[k];
+        yin[k]["b"] = b[k];
+    }
+    return gash_y_call_batch("mux", yin);
+}
+
+vector<ring_t> gash_y_open_batch(vector<yshare_t>& y)
+{
+    vector<ring_t> perm(y.size(), 0);
+    vector<ring_t> ret(y.size(), 0);
+
+    // The permute bits of the labels of 0 decode the evaluator's labels, as
+    // the output map would
+    if (m_id == 0) {
+        for (u32 j = 0; j < y.size(); j++) {
+            GASSERT(y[j].size() <= CONFIG_L);
+            for (u32 i = 0; i < y[j].size(); i++) {
+                perm[j] |= (ring_t)get_lsb(y[j][i]) << i;
+            }
+        }
+        if (tcp_send_u64_vec(m_garbler->m_peer_sock, perm) < 0 ||
+            tcp_recv_u64_vec(m_garbler->m_peer_sock, ret) < 0 || ret.size() != y.size()) {
+            FATAL("Failed to open garbled shares");
+        }
+    } else {
+        if (tcp_recv_u64_vec(m_evaluator->m_peer_sock, perm) < 0 || perm.size() != y.size()) {
+            FATAL("Failed to open garbled shares");
+        }
+        for (u32 j = 0; j < y.size(); j++) {
+            GASSERT(y[j].size() <= CONFIG_L);
+            for (u32 i = 0; i < y[j].size(); i++) {
+                ret[j] |= (ring_t)get_lsb(y[j][i]) << i;
+            }
+            ret[j] ^= perm[j];
+        }
+        if (tcp_send_u64_vec(m_evaluator->m_peer_sock, ret) < 0) {
+            FATAL("Failed to open garbled shares");
+        }
     }
 
     return ret;
@@ -546,24 +1274,34 @@ void gash_ss_generate_triplet()
 
 void gash_ss_share_triplet_master()
 {
+    vector<mpz_class> xs;
+    xs.reserve(3 * m_tri_stack.size());
+
+    // Top of the stack first, the slaves push them in the same order
     while (!m_tri_stack.empty())
     {
-        triplet_t tri = m_tri_stack.top();
-        gash_ss_send_share(tri.m_u);
-        gash_ss_send_share(tri.m_v);
-        gash_ss_send_share(tri.m_z);
+        triplet_t& tri = m_tri_stack.top();
+        xs.push_back(tri.m_u);
+        xs.push_back(tri.m_v);
+        xs.push_back(tri.m_z);
         m_tri_stack.pop();
     }
+
+    if (gash_ss_send_shares(xs) < 0) {
+        FATAL("Failed to send triplet shares");
+    }
 }
 
 void gash_ss_share_triplet_slave()
 {
-    mpz_class u, v, z;
-    for (int i = 0; i < TRIPLET_BATCH_SZ; ++i) {
-        gash_ss_recv_share(u);
-        gash_ss_recv_share(v);
-        gash_ss_recv_share(z);
-        m_tri_stack.push({u, v, z});
+    vector<mpz_class> shares;
+
+    if (gash_ss_recv_shares(shares) < 0 || shares.size() % 3 != 0) {
+        FATAL("Failed to receive triplet shares");
+    }
+
+    for (u32 i = 0; i < shares.size(); i += 3) {
+        m_tri_stack.push({shares[i], shares[i + 1], shares[i + 2]});
     }
 }
 
@@ -571,15 +1309,160 @@ triplet_t gash_ss_get_next_triplet()
 {
     if (m_tri_stack.empty())
     {
-        FATAL("Not enough triplet");
+        ring_triplet_t rt;
+        if (!dealer_take(rt)) {
+            FATAL("Not enough triplet");
+        }
+        return {mpz_class(rt.m_u), mpz_class(rt.m_v), mpz_class(rt.m_z)};
     }
     triplet_t tri = m_tri_stack.top();
     m_tri_stack.pop();
     return tri;
 }
 
+/*
+ * Lazy secdouble graph
+ *
+ * Nodes are recorded in creation order, which is a topological order. A
+ * multiplication is one level deeper than its deepest operand, additions and
+ * subtractions are local and sit at the level of their deepest operand. The
+ * flush runs level by level: all multiplications of the level in one
+ * gash_ss_mul_rescale_batch round, then the local nodes of the level.
+ */
+
+enum ss_lazy_op { SS_LAZY_MUL, SS_LAZY_ADD, SS_LAZY_SUB };
+
+struct ss_lazy_node {
+    ss_lazy_op m_op;
+    u32 m_depth = 0;
+
+    /// An operand is m_arg[i] if it is pending, m_in[i] otherwise
+    std::shared_ptr<ss_lazy_node> m_arg[2];
+    mpz_class m_in[2];
+
+    bool m_done = false;
+    mpz_class m_val;
+};
+
+static bool m_lazy = false;
+static vector<std::shared_ptr<ss_lazy_node> > m_lazy_pending;
+
+static std::shared_ptr<ss_lazy_node> lazy_record(ss_lazy_op op, const secdouble& a, const secdouble& b)
+{
+    std::shared_ptr<ss_lazy_node> node = std::make_shared<ss_lazy_node>();
+    const secdouble* in[2] = { &a, &b };
+
+    node->m_op = op;
+    for (int i = 0; i < 2; ++i) {
+        if (in[i]->m_node && !in[i]->m_node->m_done) {
+            node->m_arg[i] = in[i]->m_node;
+            node->m_depth = std::max(node->m_depth, in[i]->m_node->m_depth);
+        } else if (in[i]->m_node) {
+            node->m_in[i] = in[i]->m_node->m_val;
+        } else {
+            node->m_in[i] = in[i]->m_mpz;
+        }
+    }
+    if (op == SS_LAZY_MUL) {
+        node->m_depth++;
+    }
+
+    m_lazy_pending.push_back(node);
+    return node;
+}
+
+static inline const mpz_class& lazy_arg(const ss_lazy_node& node, int i)
+{
+    return node.m_arg[i] ? node.m_arg[i]->m_val : node.m_in[i];
+}
+
+static inline bool lazy_pending(const secdouble& a, const secdouble& b)
+{
+    return m_lazy && (a.m_node || b.m_node);
+}
+
+void gash_ss_lazy_begin()
+{
+    m_lazy = true;
+}
+
+int gash_ss_lazy_flush()
+{
+    vector<std::shared_ptr<ss_lazy_node> > nodes;
+    vector<ss_lazy_node*> muls;
+    vector<mpz_class> as, bs, cs;
+    u32 depth = 0;
+    int rounds = 0;
+
+    nodes.swap(m_lazy_pending);
+    for (auto& node : nodes) {
+        depth = std::max(depth, node->m_depth);
+    }
+
+    for (u32 d = 0; d <= depth; ++d) {
+        muls.clear();
+        as.clear();
+        bs.clear();
+        for (auto& node : nodes) {
+            if (node->m_op == SS_LAZY_MUL && node->m_depth == d) {
+                muls.push_back(node.get());
+                as.push_back(lazy_arg(*node, 0));
+                bs.push_back(lazy_arg(*node, 1));
+            }
+        }
+
+        if (!muls.empty()) {
+            cs = gash_ss_mul_rescale_batch(as, bs);
+            for (u32 i = 0; i < muls.size(); ++i) {
+                muls[i]->m_val = cs[i];
+                muls[i]->m_done = true;
+            }
+            rounds++;
+        }
+
+        for (auto& node : nodes) {
+            if (node->m_op != SS_LAZY_MUL && node->m_depth == d) {
+                if (node->m_op == SS_LAZY_ADD)
+                    node->m_val = lazy_arg(*node, 0) + lazy_arg(*node, 1);
+                else
+                    node->m_val = lazy_arg(*node, 0) - lazy_arg(*node, 1);
+                node->m_val %= m_config_l;
+                node->m_done = true;
+            }
+        }
+    }
+
+    // Only the secdoubles that still point at a node keep it alive
+    for (auto& node : nodes) {
+        node->m_arg[0].reset();
+        node->m_arg[1].reset();
+    }
+
+    return rounds;
+}
+
+int gash_ss_lazy_end()
+{
+    int rounds = gash_ss_lazy_flush();
+    m_lazy = false;
+    return rounds;
+}
+
+const mpz_class& secdouble::value()
+{
+    if (m_node) {
+        if (!m_node->m_done) {
+            gash_ss_lazy_flush();
+        }
+        m_mpz = m_node->m_val;
+        m_node.reset();
+    }
+    return m_mpz;
+}
+
 void secdouble::scaleup()
 {
+    value();
     mpz_class one = 1;
     mpz_mul_2exp(m_mpz.get_mpz_t(), one.get_mpz_t(), CONFIG_S);
     m_mpz %= m_config_l;
@@ -587,6 +1470,7 @@ void secdouble::scaleup()
 
 void secdouble::scaledown()
 {
+    value();
     gash_ss_rescale_p2p(m_mpz);
 }
 
@@ -611,37 +1495,54 @@ secdouble::secdouble(double d) {
 
 secdouble secdouble::operator*(secdouble rhs)
 {
-    // Secure multiplication
+    // Secure multiplication, rescaled in the same round
     // Both *this and y are shares
-    mpz_class ret = gash_ss_mul(this->m_mpz, rhs.m_mpz);
-    gash_ss_rescale_p2p(ret);
-    return secdouble(ret);
+    if (m_lazy) {
+        secdouble ret;
+        ret.m_node = lazy_record(SS_LAZY_MUL, *this, rhs);
+        return ret;
+    }
+
+    vector<mpz_class> as(1, this->value());
+    vector<mpz_class> bs(1, rhs.value());
+    return secdouble(gash_ss_mul_rescale_batch(as, bs)[0]);
 }
 
 secdouble secdouble::operator*=(secdouble rhs)
 {
-    this->m_mpz = gash_ss_mul(this->m_mpz, rhs.m_mpz);
-    gash_ss_rescale_p2p(this->m_mpz);
+    *this = *this * rhs;
     return *this;
 }
 
 secdouble secdouble::operator+(secdouble rhs)
 {
     secdouble ret;
-    ret.m_mpz = this->m_mpz + rhs.m_mpz;
+    if (lazy_pending(*this, rhs)) {
+        ret.m_node = lazy_record(SS_LAZY_ADD, *this, rhs);
+        return ret;
+    }
+
+    ret.m_mpz = this->value() + rhs.value();
     ret.m_mpz %= m_config_l;
     return ret;
 }
 
 secdouble secdouble::operator+=(secdouble rhs)
 {
-    m_mpz += rhs.m_mpz;
+    if (lazy_pending(*this, rhs)) {
+        m_node = lazy_record(SS_LAZY_ADD, *this, rhs);
+        return *this;
+    }
+
+    value();
+    m_mpz += rhs.value();
     return *this;
 }
 
 secdouble& secdouble::operator=(secdouble rhs)
 {
     m_mpz = rhs.m_mpz;
+    m_node = rhs.m_node;
     return *this;
 }
 
@@ -651,7 +1552,7 @@ secdouble secdouble::operator/(secdouble rhs)
 
     // Scale up again
     scaleup();
-    ret.m_mpz = gash_ss_div(this->m_mpz, rhs.m_mpz);
+    ret.m_mpz = gash_ss_div(this->m_mpz, rhs.value());
 
     return ret;
 }
@@ -659,20 +1560,1115 @@ secdouble secdouble::operator/(secdouble rhs)
 secdouble secdouble::operator-(secdouble rhs)
 {
     secdouble ret;
-    ret.m_mpz = m_mpz - rhs.m_mpz;
+    if (lazy_pending(*this, rhs)) {
+        ret.m_node = lazy_record(SS_LAZY_SUB, *this, rhs);
+        return ret;
+    }
+
+    ret.m_mpz = value() - rhs.value();
     ret.m_mpz %= m_config_l;
     return ret;
 }
 
 secdouble secdouble::operator-=(secdouble rhs)
 {
-    m_mpz -= rhs.m_mpz;
+    if (lazy_pending(*this, rhs)) {
+        m_node = lazy_record(SS_LAZY_SUB, *this, rhs);
+        return *this;
+    }
+
+    value();
+    m_mpz -= rhs.value();
     m_mpz %= m_config_l;
     return *this;
 }
 
 int secdouble::operator>(secdouble rhs)
 {
-    int ret = gash_ss_la(this->m_mpz, rhs.m_mpz);
+    int ret = gash_ss_la(this->value(), rhs.value());
     return ret;
 }
+
+/*
+ * Native ring path
+ *
+ * Shares are ring_t and every operation wraps around mod 2^64 for free, so
+ * there is no reduction and no allocation per operation. Products that need
+ * more than 64 bits go through unsigned __int128.
+ *
+ */
+
+static_assert(CONFIG_L == 64, "The native ring path needs CONFIG_L == 64");
+
+#define RING_MASK_L_S ((((ring_t)1) << CONFIG_L_S) - 1)
+
+static vector<ring_triplet_t> m_ring_tri;
+
+/// Truncation pair, see gash_ring_share_trunc_pairs_master
+typedef struct ring_trunc_pair {
+    ring_t m_r;
+    ring_t m_rh;
+    ring_t m_rb;
+} ring_trunc_pair_t;
+
+static std::deque<ring_trunc_pair_t> m_ring_trunc;
+
+static size_t ring_trunc_left()
+{
+    return m_ring_trunc.size();
+}
+
+static inline ring_t ring_random()
+{
+    return (ring_t)_mm_cvtsi128_si64(prg_block());
+}
+
+static inline int ring_send(int sock, ring_t v)
+{
+    return gashgc::tcp_send_bytes(sock, (char*)&v, sizeof(ring_t));
+}
+
+static inline int ring_recv(int sock, ring_t& v)
+{
+    return gashgc::tcp_recv_bytes(sock, (char*)&v, sizeof(ring_t));
+}
+
+static inline int ring_send_n(int sock, const ring_t* v, u32 n)
+{
+    return gashgc::tcp_send_bulk(sock, (const char*)v, (u64)n * sizeof(ring_t));
+}
+
+static inline int ring_recv_n(int sock, ring_t* v, u32 n)
+{
+    return gashgc::tcp_recv_bulk(sock, (char*)v, (u64)n * sizeof(ring_t));
+}
+
+int gash_ring_recon_p2p(ring_t share, ring_t& ret)
+{
+    if (m_id == 0)
+    {
+        REQUIRE_GOOD_STATUS(ring_send(m_ss_peer_sock, share));
+        REQUIRE_GOOD_STATUS(ring_recv(m_ss_peer_sock, ret));
+    } else {
+        REQUIRE_GOOD_STATUS(ring_recv(m_ss_peer_sock, ret));
+        REQUIRE_GOOD_STATUS(ring_send(m_ss_peer_sock, share));
+    }
+    ret += share;
+    return 0;
+}
+
+int gash_ring_recon_p2p_batch(const vector<ring_t>& shares, vector<ring_t>& ret)
+{
+    if (m_id == 0)
+    {
+        REQUIRE_GOOD_STATUS(tcp_send_u64_vec(m_ss_peer_sock, shares));
+        REQUIRE_GOOD_STATUS(tcp_recv_u64_vec(m_ss_peer_sock, ret));
+    } else {
+        REQUIRE_GOOD_STATUS(tcp_recv_u64_vec(m_ss_peer_sock, ret));
+        REQUIRE_GOOD_STATUS(tcp_send_u64_vec(m_ss_peer_sock, shares));
+    }
+
+    if (ret.size() != shares.size()) {
+        WARNING("Peer opened " << ret.size() << " shares, expected " << shares.size());
+        return -G_EINVAL;
+    }
+
+    for (u32 i = 0; i < ret.size(); ++i) {
+        ret[i] += shares[i];
+    }
+    return 0;
+}
+
+int gash_ring_recon_slave(ring_t share)
+{
+    return ring_send(m_ss_client_sock, share);
+}
+
+int gash_ring_recon_master(i64& ret)
+{
+    ring_t share0;
+    ring_t share1;
+    REQUIRE_GOOD_STATUS(ring_recv(m_ss_p0_sock, share0));
+    REQUIRE_GOOD_STATUS(ring_recv(m_ss_p1_sock, share1));
+
+    // The upper half of the ring holds the negative values
+    ret = (i64)(share0 + share1);
+    return 0;
+}
+
+int gash_ring_send_share(ring_t x)
+{
+    ring_t share0 = ring_random();
+    ring_t share1 = x - share0;
+
+    REQUIRE_GOOD_STATUS(ring_send(m_ss_p0_sock, share0));
+    REQUIRE_GOOD_STATUS(ring_send(m_ss_p1_sock, share1));
+    return 0;
+}
+
+int gash_ring_recv_share(ring_t& share)
+{
+    return ring_recv(m_ss_client_sock, share);
+}
+
+int gash_ring_send_shares(const vector<ring_t>& xs)
+{
+    vector<ring_t> share0(xs.size());
+    vector<ring_t> share1(xs.size());
+
+    for (u32 i = 0; i < xs.size(); ++i) {
+        share0[i] = ring_random();
+        share1[i] = xs[i] - share0[i];
+    }
+
+    REQUIRE_GOOD_STATUS(tcp_send_u64_vec(m_ss_p0_sock, share0));
+    REQUIRE_GOOD_STATUS(tcp_send_u64_vec(m_ss_p1_sock, share1));
+    return 0;
+}
+
+int gash_ring_recv_shares(vector<ring_t>& shares)
+{
+    return tcp_recv_u64_vec(m_ss_client_sock, shares);
+}
+
+int gash_ring_rescale_p2p(ring_t& x)
+{
+    typedef unsigned __int128 u128;
+
+    // Same masking as gash_ss_rescale_p2p, r has CONFIG_L + CONFIG_K bits
+    u128 r = ((u128)(ring_random() & ((((ring_t)1) << (CONFIG_K)) - 1)) << CONFIG_L) | ring_random();
+    u128 v;
+
+    if (m_id == 0) {
+        v = (u128)x + r;
+        REQUIRE_GOOD_STATUS(gashgc::tcp_send_bytes(m_ss_peer_sock, (char*)&v, sizeof(u128)));
+        x = -((ring_t)(r >> CONFIG_S) & RING_MASK_L_S);
+    } else {
+        REQUIRE_GOOD_STATUS(gashgc::tcp_recv_bytes(m_ss_peer_sock, (char*)&v, sizeof(u128)));
+        v += x;
+        x = (ring_t)(v >> CONFIG_S) & RING_MASK_L_S;
+    }
+
+    return 0;
+}
+
+static inline ring_t ring_beaver_share(ring_t a, ring_t b, ring_t e, ring_t f,
+                                       const ring_triplet_t& tri)
+{
+    ring_t ci = f * a + e * b + tri.m_z;
+    if (m_id == 1)
+        ci -= e * f;
+    return ci;
+}
+
+vector<ring_t> gash_ring_mul_batch(const vector<ring_t>& a, const vector<ring_t>& b)
+{
+    GASSERT(a.size() == b.size());
+
+    u32 n = a.size();
+    vector<ring_triplet_t> tri(n);
+    vector<ring_t> ef(2 * n);
+    vector<ring_t> opened;
+    vector<ring_t> ret(n);
+
+    for (u32 i = 0; i < n; ++i) {
+        tri[i] = gash_ring_get_next_triplet();
+        ef[2 * i] = a[i] - tri[i].m_u;
+        ef[2 * i + 1] = b[i] - tri[i].m_v;
+    }
+
+    if (gash_ring_recon_p2p_batch(ef, opened) < 0) {
+        FATAL("Failed to open e and f");
+    }
+
+    for (u32 i = 0; i < n; ++i) {
+        ret[i] = ring_beaver_share(a[i], b[i], opened[2 * i], opened[2 * i + 1], tri[i]);
+    }
+
+    return ret;
+}
+
+/**
+ * Open `mine` and truncate the nout products computed from the opened values,
+ * each with a truncation pair. `share` computes this party's product shares
+ * into c from the opened values.
+ * - Party 1 sends its shares to open.
+ * - Party 0 opens them and answers with its own shares and with its masked
+ *   products c0 + 2^(L - 2) + r0.
+ * - Party 1 opens c = x + 2^(L - 2) + r and sends it back.
+ * Both then take their share of x >> CONFIG_S as gash_ring_rescale_batch does.
+ * Party 1 is done after one round trip, party 0 half a round later. `opened`
+ * and `c` are scratch of nmine and nout elements, so a single product needs no
+ * allocation.
+ *
+ */
+template <typename F>
+static void ring_open_rescale(const ring_t* mine, ring_t* opened, u32 nmine,
+                              ring_t* c, ring_t* ret, u32 nout, F share)
+{
+    ring_t bias = (ring_t)1 << (CONFIG_L - 2);
+
+    if (m_ring_trunc.size() < nout) {
+        FATAL("Not enough truncation pairs, " << m_ring_trunc.size() << " for " << nout);
+    }
+
+    if (m_id == 0) {
+        if (ring_recv_n(m_ss_peer_sock, opened, nmine) < 0) {
+            FATAL("Failed to receive the shares to open");
+        }
+        for (u32 i = 0; i < nmine; ++i) {
+            opened[i] += mine[i];
+        }
+        share(opened, c);
+
+        for (u32 i = 0; i < nout; ++i) {
+            c[i] += bias + m_ring_trunc[i].m_r;
+        }
+        if (ring_send_n(m_ss_peer_sock, mine, nmine) < 0 ||
+            ring_send_n(m_ss_peer_sock, c, nout) < 0 ||
+            ring_recv_n(m_ss_peer_sock, c, nout) < 0) {
+            FATAL("Failed to exchange the masked products");
+        }
+    } else {
+        if (ring_send_n(m_ss_peer_sock, mine, nmine) < 0 ||
+            ring_recv_n(m_ss_peer_sock, opened, nmine) < 0) {
+            FATAL("Failed to exchange the shares to open");
+        }
+        for (u32 i = 0; i < nmine; ++i) {
+            opened[i] += mine[i];
+        }
+        share(opened, c);
+
+        // ret holds party 0's masked products until the truncation below
+        if (ring_recv_n(m_ss_peer_sock, ret, nout) < 0) {
+            FATAL("Failed to receive the masked products");
+        }
+        for (u32 i = 0; i < nout; ++i) {
+            c[i] += ret[i] + m_ring_trunc[i].m_r;
+        }
+        if (ring_send_n(m_ss_peer_sock, c, nout) < 0) {
+            FATAL("Failed to send the opened products");
+        }
+    }
+
+    for (u32 i = 0; i < nout; ++i) {
+        ring_trunc_pair_t& p = m_ring_trunc.front();
+        ret[i] = ring_trunc_share(m_id, c[i], p.m_rh, p.m_rb, CONFIG_S);
+        m_ring_trunc.pop_front();
+    }
+}
+
+/**
+ * gash_ring_mul_rescale_batch with the given triplets
+ *
+ */
+static vector<ring_t> ring_mul_rescale_batch(const vector<ring_t>& a, const vector<ring_t>& b,
+                                             const vector<ring_triplet_t>& tri)
+{
+    u32 n = a.size();
+    vector<ring_t> ef(2 * n);
+    vector<ring_t> opened(2 * n);
+    vector<ring_t> c(n);
+    vector<ring_t> ret(n);
+
+    for (u32 i = 0; i < n; ++i) {
+        ef[2 * i] = a[i] - tri[i].m_u;
+        ef[2 * i + 1] = b[i] - tri[i].m_v;
+    }
+
+    ring_open_rescale(ef.data(), opened.data(), 2 * n, c.data(), ret.data(), n,
+        [&](const ring_t* o, ring_t* ci) {
+            for (u32 i = 0; i < n; ++i) {
+                ci[i] = ring_beaver_share(a[i], b[i], o[2 * i], o[2 * i + 1], tri[i]);
+            }
+        });
+
+    return ret;
+}
+
+vector<ring_t> gash_ring_mul_rescale_batch(const vector<ring_t>& a, const vector<ring_t>& b)
+{
+    GASSERT(a.size() == b.size());
+
+    vector<ring_triplet_t> tri(a.size());
+    for (u32 i = 0; i < a.size(); ++i) {
+        tri[i] = gash_ring_get_next_triplet();
+    }
+
+    return ring_mul_rescale_batch(a, b, tri);
+}
+
+ring_t gash_ring_mul_rescale(ring_t a, ring_t b)
+{
+    ring_triplet_t tri = gash_ring_get_next_triplet();
+    ring_t ef[2] = { a - tri.m_u, b - tri.m_v };
+    ring_t opened[2];
+    ring_t c, ret;
+
+    ring_open_rescale(ef, opened, 2, &c, &ret, 1, [&](const ring_t* o, ring_t* ci) {
+        *ci = ring_beaver_share(a, b, o[0], o[1], tri);
+    });
+
+    return ret;
+}
+
+ring_t gash_ring_mul(ring_t a, ring_t b)
+{
+    ring_triplet_t tri = gash_ring_get_next_triplet();
+    ring_t ef[2] = { a - tri.m_u, b - tri.m_v };
+    ring_t opened[2];
+
+    // e and f in one exchange, as gash_ring_recon_p2p_batch but without vectors
+    if (m_id == 0) {
+        if (ring_send_n(m_ss_peer_sock, ef, 2) < 0 || ring_recv_n(m_ss_peer_sock, opened, 2) < 0) {
+            FATAL("Failed to open e and f");
+        }
+    } else {
+        if (ring_recv_n(m_ss_peer_sock, opened, 2) < 0 || ring_send_n(m_ss_peer_sock, ef, 2) < 0) {
+            FATAL("Failed to open e and f");
+        }
+    }
+
+    return ring_beaver_share(a, b, opened[0] + ef[0], opened[1] + ef[1], tri);
+}
+
+void gash_ring_generate_triplet()
+{
+    ring_t u, v;
+    m_ring_tri.reserve(m_ring_tri.size() + TRIPLET_BATCH_SZ);
+    for (int i = 0; i < TRIPLET_BATCH_SZ; ++i) {
+        u = ring_random();
+        v = ring_random();
+        m_ring_tri.push_back({u, v, u * v});
+    }
+}
+
+void gash_ring_share_triplet_master()
+{
+    vector<ring_t> xs;
+    xs.reserve(3 * m_ring_tri.size());
+
+    while (!m_ring_tri.empty())
+    {
+        ring_triplet_t& tri = m_ring_tri.back();
+        xs.push_back(tri.m_u);
+        xs.push_back(tri.m_v);
+        xs.push_back(tri.m_z);
+        m_ring_tri.pop_back();
+    }
+
+    if (gash_ring_send_shares(xs) < 0) {
+        FATAL("Failed to send triplet shares");
+    }
+}
+
+void gash_ring_share_triplet_slave()
+{
+    vector<ring_t> shares;
+
+    if (gash_ring_recv_shares(shares) < 0 || shares.size() % 3 != 0) {
+        FATAL("Failed to receive triplet shares");
+    }
+
+    m_ring_tri.reserve(m_ring_tri.size() + shares.size() / 3);
+    for (u32 i = 0; i < shares.size(); i += 3) {
+        m_ring_tri.push_back({shares[i], shares[i + 1], shares[i + 2]});
+    }
+}
+
+ring_triplet_t gash_ring_get_next_triplet()
+{
+    if (m_ring_tri.empty())
+    {
+        ring_triplet_t tri;
+        if (!dealer_take(tri)) {
+            FATAL("Not enough triplet");
+        }
+        return tri;
+    }
+    ring_triplet_t tri = m_ring_tri.back();
+    m_ring_tri.pop_back();
+    return tri;
+}
+
+/*
+ * Triplet dealer
+ *
+ * Every batch, the client draws seeds s0 and s1. Party 0 expands s0 to its
+ * shares u0, v0, z0 and party 1 expands s1 to u1, v1, so the only values the
+ * client sends besides the seeds are party 1's z1 = (u0 + u1)(v0 + v1) - z0.
+ * The parties prefetch up to TRIPLET_DEALER_AHEAD batches on a background
+ * thread, and both consume the batches in the order they were dealt.
+ */
+
+static int m_tri_listen_sock = -1;
+static int m_tri_sock[2] = { -1, -1 };
+
+static std::thread* m_tri_thread = NULL;
+static std::mutex m_tri_mtx;
+static std::condition_variable m_tri_cv;
+static std::deque<ring_triplet_t> m_tri_dealt;
+static bool m_tri_stop = false;
+static bool m_tri_done = false;
+
+/**
+ * Expand `seed` to n ring elements with AES-128 in counter mode
+ *
+ */
+static void ring_prg(gashgc::block seed, ring_t* out, u32 n)
+{
+    gashgc::FixedKeyAES aes(seed);
+    gashgc::block b;
+
+    for (u32 i = 0; i < n; i += 2) {
+        b = aes.encrypt128(_mm_set_epi64x(0, i / 2));
+        out[i] = (ring_t)_mm_cvtsi128_si64(b);
+        if (i + 1 < n) {
+            out[i + 1] = (ring_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(b, b));
+        }
+    }
+}
+
+static void dealer_loop()
+{
+    const u32 n = TRIPLET_BATCH_SZ;
+    vector<ring_t> r0(3 * n);
+    vector<ring_t> r1(2 * n);
+    vector<ring_t> z1(n);
+    gashgc::block s0, s1;
+
+    while (true) {
+        // One seed per party, neither follows from the other
+        s0 = seed_block();
+        s1 = seed_block();
+        ring_prg(s0, r0.data(), 3 * n);
+        ring_prg(s1, r1.data(), 2 * n);
+
+        // Party 0 holds (r0[3i], r0[3i + 1], r0[3i + 2]), party 1 (r1[2i], r1[2i + 1], z1[i])
+        for (u32 i = 0; i < n; ++i) {
+            ring_t u = r0[3 * i] + r1[2 * i];
+            ring_t v = r0[3 * i + 1] + r1[2 * i + 1];
+            z1[i] = u * v - r0[3 * i + 2];
+        }
+
+        // Blocks while the parties are TRIPLET_DEALER_AHEAD batches ahead,
+        // fails once they hang up
+        if (gashgc::tcp_send_bytes(m_tri_sock[0], (char*)&s0, sizeof(gashgc::block)) < 0 ||
+            gashgc::tcp_send_bytes(m_tri_sock[1], (char*)&s1, sizeof(gashgc::block)) < 0 ||
+            tcp_send_u64_vec(m_tri_sock[1], z1) < 0) {
+            return;
+        }
+    }
+}
+
+static void party_loop(int id)
+{
+    const u32 n = TRIPLET_BATCH_SZ;
+    vector<ring_t> r(3 * n);
+    vector<ring_t> z;
+    gashgc::block seed;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_tri_mtx);
+            m_tri_cv.wait(lock, [] {
+                return m_tri_stop || m_tri_dealt.size() < TRIPLET_DEALER_AHEAD * TRIPLET_BATCH_SZ;
+            });
+            if (m_tri_stop) {
+                break;
+            }
+        }
+
+        if (gashgc::tcp_recv_bytes(m_tri_sock[0], (char*)&seed, sizeof(gashgc::block)) < 0) {
+            break;
+        }
+        if (id == 0) {
+            ring_prg(seed, r.data(), 3 * n);
+        } else {
+            ring_prg(seed, r.data(), 2 * n);
+            if (tcp_recv_u64_vec(m_tri_sock[0], z) < 0 || z.size() != n) {
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_tri_mtx);
+        for (u32 i = 0; i < n; ++i) {
+            if (id == 0) {
+                m_tri_dealt.push_back({r[3 * i], r[3 * i + 1], r[3 * i + 2]});
+            } else {
+                m_tri_dealt.push_back({r[2 * i], r[2 * i + 1], z[i]});
+            }
+        }
+        m_tri_cv.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(m_tri_mtx);
+    m_tri_done = true;
+    m_tri_cv.notify_all();
+}
+
+/**
+ * Take the next dealt triplet, waiting for the prefetch thread if needed
+ *
+ * @return false if there is no dealer or it hung up
+ */
+static bool dealer_take(ring_triplet_t& tri)
+{
+    if (m_tri_thread == NULL) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_tri_mtx);
+    m_tri_cv.wait(lock, [] { return !m_tri_dealt.empty() || m_tri_done; });
+    if (m_tri_dealt.empty()) {
+        return false;
+    }
+
+    tri = m_tri_dealt.front();
+    m_tri_dealt.pop_front();
+    m_tri_cv.notify_all();
+    return true;
+}
+
+int gash_triplet_dealer_init()
+{
+    int s0, s1;
+    u32 id;
+
+    REQUIRE_GOOD_STATUS(tcp_server_init2(GASH_SS_TRI_PORT, m_tri_listen_sock, s0, s1));
+
+    // The parties may connect in either order, each one says who it is
+    REQUIRE_GOOD_STATUS(gashgc::tcp_recv_bytes(s0, (char*)&id, sizeof(u32)));
+    m_tri_sock[0] = id == 0 ? s0 : s1;
+    m_tri_sock[1] = id == 0 ? s1 : s0;
+
+    // The dealer learns that the parties are gone from a failed send
+    signal(SIGPIPE, SIG_IGN);
+
+    m_tri_thread = new std::thread(dealer_loop);
+    return 0;
+}
+
+int gash_triplet_party_init(string client_ip)
+{
+    u32 id = m_id;
+
+    if (m_id != 0 && m_id != 1) {
+        WARNING("Initialize as garbler or evaluator first");
+        return -G_EINVAL;
+    }
+
+    REQUIRE_GOOD_STATUS(tcp_client_init(client_ip, GASH_SS_TRI_PORT, m_tri_sock[0]));
+    REQUIRE_GOOD_STATUS(gashgc::tcp_send_bytes(m_tri_sock[0], (char*)&id, sizeof(u32)));
+
+    m_tri_stop = m_tri_done = false;
+    m_tri_thread = new std::thread(party_loop, m_id);
+    return 0;
+}
+
+void gash_triplet_dealer_close()
+{
+    if (m_tri_thread == NULL) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_tri_mtx);
+        m_tri_stop = true;
+    }
+    m_tri_cv.notify_all();
+
+    // Unblocks a dealer or prefetch thread stuck in send or recv
+    for (int i = 0; i < 2; ++i) {
+        if (m_tri_sock[i] >= 0) {
+            shutdown(m_tri_sock[i], SHUT_RDWR);
+        }
+    }
+
+    m_tri_thread->join();
+    delete m_tri_thread;
+    m_tri_thread = NULL;
+
+    for (int i = 0; i < 2; ++i) {
+        if (m_tri_sock[i] >= 0) {
+            close(m_tri_sock[i]);
+            m_tri_sock[i] = -1;
+        }
+    }
+    if (m_tri_listen_sock >= 0) {
+        close(m_tri_listen_sock);
+        m_tri_listen_sock = -1;
+    }
+    m_tri_dealt.clear();
+}
+
+/*
+ * Two-party triplets from OT, no dealer
+ *
+ * Each party draws its own u_i, v_i and computes u_i * v_i. The cross terms
+ * u0 * v1 and v0 * u1 are shared with one OT per bit of party 1's value
+ * (Gilboa): for bit j, party 0 offers (r, r + (x << j)) and party 1 picks with
+ * the bit, so party 1 sums to x * y + sum(r) while party 0 keeps -sum(r).
+ * Party 0 is the OT sender for both terms, the garbler's OT session runs them
+ * with 64-bit messages, one ring element each.
+ */
+
+/// OTs per triplet, one per bit of v1 and one per bit of u1
+#define RING_OT_PER_TRIPLET (2 * CONFIG_L)
+
+/// Triplets per OT call, so that one call is one OT_CHUNK
+#define RING_OT_TRIPLET_CHUNK (OT_CHUNK / RING_OT_PER_TRIPLET)
+
+static int ot_triplets_send(u32 n, ring_triplet_t* out)
+{
+    const u32 m = RING_OT_PER_TRIPLET;
+    vector<ring_t> m0((u64)n * m);
+    vector<ring_t> m1((u64)n * m);
+    ring_t x;
+    u64 k;
+
+    ring_prg(seed_block(), m0.data(), n * m);
+
+    for (u32 i = 0; i < n; ++i) {
+        ring_t& z = out[i].m_z;
+        z = out[i].m_u * out[i].m_v;
+        for (u32 t = 0; t < 2; ++t) {
+            x = t == 0 ? out[i].m_u : out[i].m_v;
+            for (u32 j = 0; j < CONFIG_L; ++j) {
+                k = (u64)i * m + t * CONFIG_L + j;
+                m1[k] = m0[k] + (x << j);
+                z -= m0[k];
+            }
+        }
+    }
+
+    return m_garbler->ot_party()->OTSend64(m_garbler->m_peer_ip, m_garbler->m_ot_port, m0, m1);
+}
+
+static int ot_triplets_recv(u32 n, ring_triplet_t* out)
+{
+    const u32 m = RING_OT_PER_TRIPLET;
+    vector<u8> sel((u64)n * m);
+    ring_t y;
+
+    // u0 * v1 picks with the bits of v1, v0 * u1 with the bits of u1
+    for (u32 i = 0; i < n; ++i) {
+        out[i].m_z = out[i].m_u * out[i].m_v;
+        for (u32 t = 0; t < 2; ++t) {
+            y = t == 0 ? out[i].m_v : out[i].m_u;
+            for (u32 j = 0; j < CONFIG_L; ++j) {
+                sel[(u64)i * m + t * CONFIG_L + j] = (y >> j) & 1;
+            }
+        }
+    }
+
+    return m_evaluator->ot_party()->OTRecv64(m_evaluator->m_peer_ip, m_evaluator->m_ot_port, sel,
+        [&](u32 off, const u64* msgs, u32 cnt) {
+            for (u32 k = 0; k < cnt; ++k) {
+                out[(off + k) / m].m_z += msgs[k];
+            }
+        });
+}
+
+int gash_ring_generate_triplet_ot(u32 n)
+{
+    vector<ring_t> uv(2 * (u64)n);
+    u32 base = m_ring_tri.size();
+    u32 cnt;
+    int err;
+
+    if (m_id != 0 && m_id != 1) {
+        WARNING("Initialize as garbler or evaluator first");
+        return -G_EINVAL;
+    }
+
+    // The filler thread of an OT pool would share the OT session
+    if ((m_id == 0 && m_garbler->m_ot_pool != NULL) || (m_id == 1 && m_evaluator->m_ot_pool != NULL)) {
+        WARNING("OT triplets cannot run next to an OT pool");
+        return -G_EINVAL;
+    }
+
+    ring_prg(seed_block(), uv.data(), 2 * n);
+    m_ring_tri.resize(base + n);
+    for (u32 i = 0; i < n; ++i) {
+        m_ring_tri[base + i].m_u = uv[2 * i];
+        m_ring_tri[base + i].m_v = uv[2 * i + 1];
+    }
+
+    for (u32 i = 0; i < n; i += cnt) {
+        cnt = std::min((u32)RING_OT_TRIPLET_CHUNK, n - i);
+        err = m_id == 0 ? ot_triplets_send(cnt, &m_ring_tri[base + i])
+                        : ot_triplets_recv(cnt, &m_ring_tri[base + i]);
+        if (err < 0) {
+            m_ring_tri.resize(base);
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+int gash_ss_generate_triplet_ot(u32 n)
+{
+    u32 base = m_ring_tri.size();
+
+    REQUIRE_GOOD_STATUS(gash_ring_generate_triplet_ot(n));
+
+    for (u32 i = base; i < base + n; ++i) {
+        ring_triplet_t& tri = m_ring_tri[i];
+        m_tri_stack.push({mpz_class(tri.m_u), mpz_class(tri.m_v), mpz_class(tri.m_z)});
+    }
+    m_ring_tri.resize(base);
+
+    return 0;
+}
+
+/*
+ * Truncation pairs
+ *
+ * A pair is a uniform r with sharings of r, of (r mod 2^(L - 1)) >> CONFIG_S
+ * and of the top bit of r. Shifting x by 2^(L - 2) makes it positive, so the
+ * opened c = x + r only wraps when the top bits say so and the wrap can be
+ * undone on the shares. The client deals them like the triplets of the
+ * dealer: party 0 expands all its shares from a seed, party 1 expands its
+ * share of r from a seed and gets the other two.
+ */
+
+/**
+ * Header of a batch of pairs: count and seed
+ *
+ */
+static vector<ring_t> trunc_header(u32 n, gashgc::block seed)
+{
+    return { n, (ring_t)_mm_cvtsi128_si64(seed), (ring_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(seed, seed)) };
+}
+
+void gash_ring_share_trunc_pairs_master(u32 n)
+{
+    ring_t half = ((ring_t)1 << (CONFIG_L - 1)) - 1;
+    vector<ring_t> r0(3 * (u64)n);
+    vector<ring_t> r1(n);
+    vector<ring_t> rest(2 * (u64)n);
+    gashgc::block s0 = seed_block();
+    gashgc::block s1 = seed_block();
+    ring_t r;
+
+    ring_prg(s0, r0.data(), 3 * n);
+    ring_prg(s1, r1.data(), n);
+    for (u32 i = 0; i < n; ++i) {
+        r = r0[3 * i] + r1[i];
+        rest[2 * i] = ((r & half) >> CONFIG_S) - r0[3 * i + 1];
+        rest[2 * i + 1] = (r >> (CONFIG_L - 1)) - r0[3 * i + 2];
+    }
+
+    if (tcp_send_u64_vec(m_ss_p0_sock, trunc_header(n, s0)) < 0 ||
+        tcp_send_u64_vec(m_ss_p1_sock, trunc_header(n, s1)) < 0 ||
+        tcp_send_u64_vec(m_ss_p1_sock, rest) < 0) {
+        FATAL("Failed to send truncation pairs");
+    }
+}
+
+void gash_ring_share_trunc_pairs_slave()
+{
+    vector<ring_t> h;
+    vector<ring_t> r;
+    vector<ring_t> rest;
+
+    if (tcp_recv_u64_vec(m_ss_client_sock, h) < 0 || h.size() != 3) {
+        FATAL("Failed to receive truncation pairs");
+    }
+
+    u32 n = h[0];
+    gashgc::block seed = _mm_set_epi64x(h[2], h[1]);
+
+    if (m_id == 0) {
+        r.resize(3 * (u64)n);
+        ring_prg(seed, r.data(), 3 * n);
+        for (u32 i = 0; i < n; ++i) {
+            m_ring_trunc.push_back({r[3 * i], r[3 * i + 1], r[3 * i + 2]});
+        }
+    } else {
+        if (tcp_recv_u64_vec(m_ss_client_sock, rest) < 0 || rest.size() != 2 * (u64)n) {
+            FATAL("Failed to receive truncation pairs");
+        }
+        r.resize(n);
+        ring_prg(seed, r.data(), n);
+        for (u32 i = 0; i < n; ++i) {
+            m_ring_trunc.push_back({r[i], rest[2 * i], rest[2 * i + 1]});
+        }
+    }
+}
+
+int gash_ring_rescale_batch(vector<ring_t>& x)
+{
+    u32 n = x.size();
+    ring_t bias = m_id == 0 ? (ring_t)1 << (CONFIG_L - 2) : 0;
+    vector<ring_t> masked(n);
+    vector<ring_t> c;
+
+    if (m_ring_trunc.size() < n) {
+        WARNING("Not enough truncation pairs, " << m_ring_trunc.size() << " for " << n);
+        return -G_EINVAL;
+    }
+
+    for (u32 i = 0; i < n; ++i) {
+        masked[i] = x[i] + bias + m_ring_trunc[i].m_r;
+    }
+
+    REQUIRE_GOOD_STATUS(gash_ring_recon_p2p_batch(masked, c));
+
+    for (u32 i = 0; i < n; ++i) {
+        ring_trunc_pair_t& p = m_ring_trunc.front();
+        x[i] = ring_trunc_share(m_id, c[i], p.m_rh, p.m_rb, CONFIG_S);
+        m_ring_trunc.pop_front();
+    }
+
+    return 0;
+}
+
+/*
+ * Matrix triplets
+ *
+ * A product A B of an n x k and a k x m matrix opens E = A - U and F = B - V
+ * with one matrix triplet (U, V, Z = UV), then each party holds
+ * E B_i + A_i F + Z_i, minus E F for party 1. That is n k + k m opened values
+ * and one triplet for the n k m scalar products.
+ */
+
+typedef std::tuple<u32, u32, u32> mat_shape_t;
+
+static map<mat_shape_t, std::deque<ring_mat_triplet_t> > m_ring_mat_tri;
+
+/**
+ * C += A B, A is n x k and B is k x m
+ *
+ */
+static void ring_matmul_add(const ring_t* A, const ring_t* B, ring_t* C, u32 n, u32 k, u32 m)
+{
+    for (u32 i = 0; i < n; ++i) {
+        for (u32 l = 0; l < k; ++l) {
+            ring_t a = A[(u64)i * k + l];
+            const ring_t* b = B + (u64)l * m;
+            ring_t* c = C + (u64)i * m;
+            for (u32 j = 0; j < m; ++j) {
+                c[j] += a * b[j];
+            }
+        }
+    }
+}
+
+void gash_ring_share_mat_triplet_master(u32 n, u32 k, u32 m, u32 count)
+{
+    u64 nu = (u64)n * k;
+    u64 nv = (u64)k * m;
+    u64 nz = (u64)n * m;
+    vector<ring_t> shape = { n, k, m, count };
+    vector<ring_t> xs((nu + nv + nz) * count, 0);
+
+    for (u32 t = 0; t < count; ++t) {
+        ring_t* u = &xs[(nu + nv + nz) * t];
+        ring_t* v = u + nu;
+        ring_t* z = v + nv;
+
+        ring_prg(seed_block(), u, nu + nv);
+        ring_matmul_add(u, v, z, n, k, m);
+    }
+
+    if (tcp_send_u64_vec(m_ss_p0_sock, shape) < 0 || tcp_send_u64_vec(m_ss_p1_sock, shape) < 0 ||
+        gash_ring_send_shares(xs) < 0) {
+        FATAL("Failed to send matrix triplet shares");
+    }
+}
+
+void gash_ring_share_mat_triplet_slave()
+{
+    vector<ring_t> shape;
+    vector<ring_t> shares;
+
+    if (tcp_recv_u64_vec(m_ss_client_sock, shape) < 0 || shape.size() != 4 ||
+        gash_ring_recv_shares(shares) < 0) {
+        FATAL("Failed to receive matrix triplet shares");
+    }
+
+    u32 n = shape[0], k = shape[1], m = shape[2], count = shape[3];
+    u64 nu = (u64)n * k;
+    u64 nv = (u64)k * m;
+    u64 nz = (u64)n * m;
+    if (shares.size() != (nu + nv + nz) * count) {
+        FATAL("Matrix triplet shares do not match their shape");
+    }
+
+    std::deque<ring_mat_triplet_t>& q = m_ring_mat_tri[mat_shape_t(n, k, m)];
+    for (u32 t = 0; t < count; ++t) {
+        auto it = shares.begin() + (nu + nv + nz) * t;
+        q.push_back({vector<ring_t>(it, it + nu),
+                     vector<ring_t>(it + nu, it + nu + nv),
+                     vector<ring_t>(it + nu + nv, it + nu + nv + nz)});
+    }
+}
+
+ring_mat_triplet_t gash_ring_get_next_mat_triplet(u32 n, u32 k, u32 m)
+{
+    auto it = m_ring_mat_tri.find(mat_shape_t(n, k, m));
+    if (it == m_ring_mat_tri.end() || it->second.empty())
+    {
+        FATAL("Not enough matrix triplet for " << n << "x" << k << " by " << k << "x" << m);
+    }
+    ring_mat_triplet_t tri = std::move(it->second.front());
+    it->second.pop_front();
+    return tri;
+}
+
+secmat64 secmat64::operator+(const secmat64& rhs) const
+{
+    GASSERT(m_rows == rhs.m_rows && m_cols == rhs.m_cols);
+
+    secmat64 ret(m_rows, m_cols);
+    for (u64 i = 0; i < m_v.size(); ++i) {
+        ret.m_v[i] = m_v[i] + rhs.m_v[i];
+    }
+    return ret;
+}
+
+secmat64 secmat64::operator-(const secmat64& rhs) const
+{
+    GASSERT(m_rows == rhs.m_rows && m_cols == rhs.m_cols);
+
+    secmat64 ret(m_rows, m_cols);
+    for (u64 i = 0; i < m_v.size(); ++i) {
+        ret.m_v[i] = m_v[i] - rhs.m_v[i];
+    }
+    return ret;
+}
+
+secmat64 secmat64::operator*(const secmat64& rhs) const
+{
+    GASSERT(m_cols == rhs.m_rows);
+
+    u32 n = m_rows, k = m_cols, m = rhs.m_cols;
+    u64 nu = (u64)n * k;
+    ring_mat_triplet_t tri = gash_ring_get_next_mat_triplet(n, k, m);
+    vector<ring_t> ef(nu + (u64)k * m);
+
+    // 1), 2) E and F are opened together
+    for (u64 i = 0; i < nu; ++i) {
+        ef[i] = m_v[i] - tri.m_u[i];
+    }
+    for (u64 i = 0; i < (u64)k * m; ++i) {
+        ef[nu + i] = rhs.m_v[i] - tri.m_v[i];
+    }
+
+    // 3), 4) and the rescale of every entry, in one round trip
+    vector<ring_t> opened(ef.size());
+    vector<ring_t> c((u64)n * m);
+    vector<ring_t> ret((u64)n * m);
+    ring_open_rescale(ef.data(), opened.data(), ef.size(), c.data(), ret.data(), n * m,
+        [&](const ring_t* E, ring_t* ci) {
+            const ring_t* F = E + nu;
+
+            std::copy(tri.m_z.begin(), tri.m_z.end(), ci);
+            ring_matmul_add(E, rhs.m_v.data(), ci, n, k, m);
+            ring_matmul_add(m_v.data(), F, ci, n, k, m);
+            if (m_id == 1) {
+                vector<ring_t> ef_prod((u64)n * m, 0);
+                ring_matmul_add(E, F, ef_prod.data(), n, k, m);
+                for (u64 i = 0; i < ef_prod.size(); ++i) {
+                    ci[i] -= ef_prod[i];
+                }
+            }
+        });
+
+    return secmat64(n, m, ret);
+}
+
+secmat64 secmat64::transpose() const
+{
+    secmat64 ret(m_cols, m_rows);
+    for (u32 i = 0; i < m_rows; ++i) {
+        for (u32 j = 0; j < m_cols; ++j) {
+            ret.m_v[(u64)j * m_rows + i] = m_v[(u64)i * m_cols + j];
+        }
+    }
+    return ret;
+}
+
+secdouble64 gash_ring_dot(const secmat64& a, const secmat64& b)
+{
+    GASSERT(a.m_v.size() == b.m_v.size());
+
+    // A 1 x n by n x 1 product, any vector shape works since they are row-major
+    u32 n = a.m_v.size();
+    secmat64 row(1, n, a.m_v);
+    secmat64 col(n, 1, b.m_v);
+    return (row * col).get(0, 0);
+}
+
+void secdouble64::scaleup()
+{
+    m_v <<= CONFIG_S;
+}
+
+void secdouble64::scaledown()
+{
+    gash_ring_rescale_p2p(m_v);
+}
+
+secdouble64::secdouble64(int i)
+{
+    m_v = (ring_t)(i64)i;
+    scaleup();
+}
+
+secdouble64::secdouble64(double d)
+{
+    // Scale d to d << CONFIG_S and truncate, negative values wrap around
+    m_v = (ring_t)(i64)(d * (double)(1 << CONFIG_S));
+}
+
+secdouble64& secdouble64::operator*(double& y)
+{
+    ring_t enc;
+    vector<ring_t> x;
+
+    // Exact in the ring, no rounding of the share through a double
+    if (y == std::trunc(y) && std::fabs(y) < std::ldexp(1.0, CONFIG_L - 1)) {
+        m_v *= (ring_t)(i64)y;
+        return *this;
+    }
+
+    if (std::fabs(y) >= std::ldexp(1.0, CONFIG_L - 2 - CONFIG_S)) {
+        FATAL("Public factor " << y << " is out of range");
+    }
+
+    enc = (ring_t)(i64)std::llround(std::ldexp(y, CONFIG_S));
+    x.assign(1, m_v * enc);
+    if (gash_ring_rescale_batch(x) < 0) {
+        FATAL("Multiplying by " << y << " takes a truncation pair");
+    }
+    m_v = x[0];
+    return *this;
+}
+
+secdouble64 secdouble64::operator*(secdouble64 rhs)
+{
+    return secdouble64(gash_ring_mul_rescale(m_v, rhs.m_v));
+}
+
+secdouble64 secdouble64::operator*=(secdouble64 rhs)
+{
+    m_v = gash_ring_mul_rescale(m_v, rhs.m_v);
+    return *this;
+}
+
+secdouble64 secdouble64::operator/(secdouble64 rhs)
+{
+    // The division circuit runs on GMP shares
+    scaleup();
+    mpz_class q = gash_ss_div(mpz_class(m_v), mpz_class(rhs.m_v));
+    return secdouble64((ring_t)mpz_get_ui(q.get_mpz_t()));
+}
+
+int secdouble64::operator>(secdouble64 rhs)
+{
+    return gash_ss_la(mpz_class(m_v), mpz_class(rhs.m_v));
+}
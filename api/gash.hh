@@ -24,8 +24,11 @@
 #include "../include/common.hh"
 #include "../gc/garbler.hh"
 #include "../gc/evaluator.hh"
+#include "../gc/otpool.hh"
 #include "../lang/gash_lang.hh"
+#include <memory>
 #include <stack>
+#include <tuple>
 
 using std::stack;
 
@@ -34,6 +37,7 @@ using std::stack;
 #define GASH_OT_PORT  48901
 #define GASH_SS_PORT  48998
 #define GASH_SS_CLIENT_PORT  49878
+#define GASH_SS_TRI_PORT  49879
 
 #define CONFIG_L 64
 #define CONFIG_S 20
@@ -42,12 +46,51 @@ using std::stack;
 
 #define TRIPLET_BATCH_SZ 1000
 
+/// Batches a party buffers ahead from the triplet dealer
+#define TRIPLET_DEALER_AHEAD 4
+
+typedef vector<std::pair<string, string> > NameValVec;
+
+/// A compiled circuit, reused by every call with the same key
+typedef struct circ_cache_entry {
+    string                  m_circ_fpath;   // Binary circuit file
+    gashlang::InputLayout   m_layout;       // Rewrites the data file for new inputs
+    gashgc::FlatCircuit     m_fc;           // Built once, copied into the garbler/evaluator
+    map<u32, gashgc::FlatCircuit> m_batch_fc;   // m_fc replicated, by number of instances
+} circ_cache_entry_t;
+
+typedef std::tuple<string, u32, size_t> circ_cache_key_t;
+
 typedef struct triplet {
     mpz_class m_u;
     mpz_class m_v;
     mpz_class m_z;
 } triplet_t;
 
+/// Share in the native ring Z_{2^CONFIG_L}, arithmetic wraps around
+typedef u64 ring_t;
+
+typedef struct ring_triplet {
+    ring_t m_u;
+    ring_t m_v;
+    ring_t m_z;
+} ring_triplet_t;
+
+/// Garbled share of a value, one label per bit, least significant first. The
+/// garbler holds the labels of 0, the evaluator the labels of the actual bits.
+/// They stay valid until the garbled session ends
+typedef vector<gashgc::block> yshare_t;
+
+/// Garbled inputs of one circuit instance, by parameter name
+typedef map<string, yshare_t> NameYMap;
+
+/// Matrix triplet Z = UV, U is n x k and V is k x m, all row-major
+typedef struct ring_mat_triplet {
+    vector<ring_t> m_u;
+    vector<ring_t> m_v;
+    vector<ring_t> m_z;
+} ring_mat_triplet_t;
+
 
 // Initialization
 int gash_config_init();
@@ -60,16 +103,95 @@ int gash_ss_garbler_init(string client_ip);
 int gash_ss_evaluator_init(string client_ip, string peer_ip);
 int gash_ss_client_init();
 int gash_ss_recon_p2p(mpz_class share, mpz_class& ret);
+int gash_ss_recon_p2p_batch(const vector<mpz_class>& shares, vector<mpz_class>& ret);
 int gash_ss_recon_slave(mpz_class& share);
 int gash_ss_recon_master(mpz_class& ret);
 int gash_ss_send_share(mpz_class& x);
 int gash_ss_recv_share(mpz_class& share);
+int gash_ss_send_shares(const vector<mpz_class>& xs);
+int gash_ss_recv_shares(vector<mpz_class>& shares);
 int gash_ss_rescale_p2p(mpz_class& x);
 void gash_ss_generate_triplet();
 void gash_ss_share_triplet_master();
 void gash_ss_share_triplet_slave();
 triplet_t gash_ss_get_next_triplet();
 
+// Native ring path, the same protocols on ring_t instead of mpz_class. Only
+// for CONFIG_L == 64, other ring sizes stay on the GMP path
+int gash_ring_recon_p2p(ring_t share, ring_t& ret);
+int gash_ring_recon_p2p_batch(const vector<ring_t>& shares, vector<ring_t>& ret);
+int gash_ring_recon_slave(ring_t share);
+int gash_ring_recon_master(i64& ret);
+int gash_ring_send_share(ring_t x);
+int gash_ring_recv_share(ring_t& share);
+int gash_ring_send_shares(const vector<ring_t>& xs);
+int gash_ring_recv_shares(vector<ring_t>& shares);
+int gash_ring_rescale_p2p(ring_t& x);
+
+// Batched probabilistic truncation with pairs dealt by the client. A batch
+// opens x + r in one exchange, each result is x >> CONFIG_S up to the last
+// bit as long as |x| < 2^(CONFIG_L - 2)
+void gash_ring_share_trunc_pairs_master(u32 n);
+void gash_ring_share_trunc_pairs_slave();
+int gash_ring_rescale_batch(vector<ring_t>& x);
+
+/**
+ * Party `id`'s share of x >> s, given the opened c = x + 2^(L - 2) + r and
+ * its shares rh of (r mod 2^(L - 1)) >> s and rb of the top bit of r
+ *
+ */
+inline ring_t ring_trunc_share(int id, ring_t c, ring_t rh, ring_t rb, u32 s)
+{
+    ring_t top = c >> (CONFIG_L - 1);
+    ring_t low = c & (((ring_t)1 << (CONFIG_L - 1)) - 1);
+
+    // Share of top XOR the top bit of r, it says whether x + r wrapped
+    ring_t b = rb * (1 - 2 * top) + (id == 0 ? top : 0);
+    ring_t y = (b << (CONFIG_L - 1 - s)) - rh;
+
+    return id == 0 ? y + (low >> s) - ((ring_t)1 << (CONFIG_L - 2 - s)) : y;
+}
+ring_t gash_ring_mul(ring_t a, ring_t b);
+vector<ring_t> gash_ring_mul_batch(const vector<ring_t>& a, const vector<ring_t>& b);
+
+// Multiply and truncate each product with a truncation pair, in one round trip
+// plus one message back to party 0. Exact up to the last bit as long as the
+// products stay below 2^(CONFIG_L - 2)
+ring_t gash_ring_mul_rescale(ring_t a, ring_t b);
+vector<ring_t> gash_ring_mul_rescale_batch(const vector<ring_t>& a, const vector<ring_t>& b);
+void gash_ring_generate_triplet();
+void gash_ring_share_triplet_master();
+void gash_ring_share_triplet_slave();
+ring_triplet_t gash_ring_get_next_triplet();
+
+// Matrix triplets, dealt by the client for the shapes the parties will
+// multiply: `count` triplets for an n x k by k x m product
+void gash_ring_share_mat_triplet_master(u32 n, u32 k, u32 m, u32 count);
+void gash_ring_share_mat_triplet_slave();
+ring_mat_triplet_t gash_ring_get_next_mat_triplet(u32 n, u32 k, u32 m);
+
+// Triplet dealer. The client deals batches of TRIPLET_BATCH_SZ triplets in the
+// background, party 0 gets a PRG seed per batch, party 1 a seed and its z
+// shares. gash_ss_get_next_triplet and gash_ring_get_next_triplet draw from
+// it once their own triplets run out
+int gash_triplet_dealer_init();
+int gash_triplet_party_init(string client_ip);
+void gash_triplet_dealer_close();
+
+// Two-party triplets from OT extension, without the client. Both parties call
+// it with the same n, the garbler's and evaluator's OT session is used
+int gash_ss_generate_triplet_ot(u32 n);
+int gash_ring_generate_triplet_ot(u32 n);
+
+// Compiled circuit cache, returns the number of cached circuits
+int gash_circ_cache_stats(u64& hit, u64& miss);
+void gash_circ_cache_clear();
+
+// Random OT pool for the input labels, both peers call gash_ot_precompute
+// with the same arguments after gash_connect_peer
+int gash_ot_precompute(u32 n, u32 batch);
+int gash_ot_pool_stats(gashgc::OTPoolStats& stats);
+
 // Circuit functions
 mpz_class gash_ss_mul(mpz_class a, mpz_class b);
 mpz_class gash_ss_div(mpz_class a, mpz_class b);
@@ -78,11 +200,66 @@ mpz_class gash_ss_relu(mpz_class x);
 mpz_class gash_ss_relugrad(mpz_class x);
 /* mpz_class gash_ss_approx_exp(mpz_class x); */
 
+// Batched multiplication, one round for all of them. The rescale variant
+// truncates as gash_ring_mul_rescale_batch, with the same truncation pairs,
+// and falls back to gash_ss_rescale_p2p per product when too few are dealt
+vector<mpz_class> gash_ss_mul_batch(const vector<mpz_class>& a, const vector<mpz_class>& b);
+vector<mpz_class> gash_ss_mul_rescale_batch(const vector<mpz_class>& a, const vector<mpz_class>& b);
+
+// Batched circuit functions, all instances run in one garbled circuit with one OT
+vector<mpz_class> gash_ss_relu_batch(vector<mpz_class>& x);
+vector<mpz_class> gash_ss_relugrad_batch(vector<mpz_class>& x);
+vector<int> gash_ss_la_batch(vector<mpz_class>& a, vector<mpz_class>& b);
+vector<mpz_class> gash_ss_div_batch(vector<mpz_class>& a, vector<mpz_class>& b);
+
+// Conversions between arithmetic and garbled shares. A2Y adds the two shares
+// in a garbled circuit, once per value; Y2A needs no circuit, only one message
+// from the garbler. In between, the circuit functions below take and return
+// garbled shares, without adding or masking anything themselves
+vector<yshare_t> gash_ss_a2y_batch(vector<mpz_class>& x);
+vector<mpz_class> gash_ss_y2a_batch(vector<yshare_t>& y);
+vector<yshare_t> gash_ring_a2y_batch(vector<ring_t>& x);
+vector<ring_t> gash_ring_y2a_batch(vector<yshare_t>& y);
+
+vector<yshare_t> gash_y_relu_batch(vector<yshare_t>& x);
+vector<int> gash_y_la_batch(vector<yshare_t>& a, vector<yshare_t>& b);
+vector<yshare_t> gash_y_div_batch(vector<yshare_t>& a, vector<yshare_t>& b);
+
+// Garbled sessions. Between begin and end the garbler keeps one R, so the
+// outputs of one circuit go on as labels into the inputs of the next, with no
+// OT and no conversion in between. The calls above and below abort outside a
+// session; end drops R and every garbled share of the session with it
+void gash_gc_session_begin();
+void gash_gc_session_end();
+
+// Run registry function `name` on garbled inputs, by parameter name, and keep
+// its output garbled. gt gives a garbled bit, mux picks a where the bit is set
+// and b elsewhere, open reveals garbled shares to both parties
+vector<yshare_t> gash_y_call_batch(string name, vector<NameYMap>& args);
+vector<yshare_t> gash_y_gt_batch(vector<yshare_t>& a, vector<yshare_t>& b);
+vector<yshare_t> gash_y_mux_batch(vector<yshare_t>& c, vector<yshare_t>& a, vector<yshare_t>& b);
+vector<ring_t> gash_y_open_batch(vector<yshare_t>& y);
+
+// Lazy secdouble mode. Between begin and end, secdouble operations record
+// nodes of a graph instead of running. A flush runs the graph with one
+// batched multiply-and-rescale round per multiplicative depth, and returns the
+// number of rounds. Read the results with secdouble::value(), which flushes
+// if needed; end flushes and leaves lazy mode
+void gash_ss_lazy_begin();
+int gash_ss_lazy_flush();
+int gash_ss_lazy_end();
+
+struct ss_lazy_node;
+
 // Secdouble
 class secdouble
 {
 public:
     mpz_class m_mpz;
+
+    /// Pending result in lazy mode, m_mpz is valid once it is NULL
+    std::shared_ptr<ss_lazy_node> m_node;
+
     secdouble(){}
     secdouble(int i);
     secdouble(double d);
@@ -91,8 +268,16 @@ public:
     void scaleup();
     void scaledown();
 
+    /**
+     * The share, after running the pending graph if this is still a node of it
+     *
+     * @return
+     */
+    const mpz_class& value();
+
     secdouble& operator*(double& y) {
         // Simple multiplication, y is assumed to have no scaling factor
+        value();
         m_mpz *= y;
         return *this;
     }
@@ -108,4 +293,56 @@ public:
 
 };
 
+// Secdouble on the native ring, fixed point with CONFIG_S fraction bits. A
+// multiplication takes a triplet and a truncation pair
+class secdouble64
+{
+public:
+    ring_t m_v = 0;
+    secdouble64(){}
+    secdouble64(int i);
+    secdouble64(double d);
+    explicit secdouble64(ring_t v) : m_v(v) {}
+
+    void scaleup();
+    void scaledown();
+
+    // Multiply by a public y, y is assumed to have no scaling factor. An
+    // integer y scales the share locally, any other y is multiplied in fixed
+    // point and takes a truncation pair
+    secdouble64& operator*(double& y);
+    secdouble64 operator+(secdouble64 rhs) { return secdouble64(m_v + rhs.m_v); }
+    secdouble64 operator+=(secdouble64 rhs) { m_v += rhs.m_v; return *this; }
+    secdouble64 operator*(secdouble64 rhs);  // Secure multiplication
+    secdouble64 operator*=(secdouble64 rhs);
+    secdouble64 operator/(secdouble64 rhs);
+    secdouble64 operator-(secdouble64 rhs) { return secdouble64(m_v - rhs.m_v); }
+    secdouble64 operator-=(secdouble64 rhs) { m_v -= rhs.m_v; return *this; }
+    int operator>(secdouble64 rhs);
+};
+
+// Secret-shared matrix on the native ring, row-major, fixed point as
+// secdouble64. A vector is a matrix with one column
+class secmat64
+{
+public:
+    u32 m_rows = 0;
+    u32 m_cols = 0;
+    vector<ring_t> m_v;
+    secmat64(){}
+    secmat64(u32 rows, u32 cols) : m_rows(rows), m_cols(cols), m_v((u64)rows * cols, 0) {}
+    secmat64(u32 rows, u32 cols, const vector<ring_t>& v) : m_rows(rows), m_cols(cols), m_v(v) {}
+
+    ring_t& at(u32 i, u32 j) { return m_v[(u64)i * m_cols + j]; }
+    secdouble64 get(u32 i, u32 j) const { return secdouble64(m_v[(u64)i * m_cols + j]); }
+
+    secmat64 operator+(const secmat64& rhs) const;
+    secmat64 operator-(const secmat64& rhs) const;
+    secmat64 operator*(const secmat64& rhs) const;  // Secure product, one matrix triplet and a truncation pair per entry
+    secmat64 transpose() const;
+};
+
+// Dot product of two vectors of the same length, one round
+secdouble64 gash_ring_dot(const secmat64& a, const secmat64& b);
+
 #endif
@@ -176,4 +176,15 @@ namespace gashgc {
         ret = _mm_xor_si128(_mm_xor_si128(ret, K), cipher);
         return ret;
     }
+
+    FixedKeyAES::FixedKeyAES()
+    {
+        // Read the key bytes directly, AESkey may not be initialized yet
+        expand_key128(_mm_loadu_si128((const __m128i*)AESkey_buf), m_rndkeys);
+    }
+
+    FixedKeyAES::FixedKeyAES(block key)
+    {
+        expand_key128(key, m_rndkeys);
+    }
 } // namespace gashgc
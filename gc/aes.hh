@@ -23,6 +23,61 @@
 #include <wmmintrin.h>
 #include "../include/common.hh"
 
+/// Number of blocks FixedKeyAES::encrypt_n keeps in flight
+#define AES_BATCH_SZ 8
+
+/// Unrolled AES-128 rounds over the registers s0 (s0..s3, s0..s7)
+#define AES_ROUND_X1(op, key)                                           \
+  s0 = op(s0, key);
+#define AES_ROUND_X4(op, key)                                           \
+  s0 = op(s0, key); s1 = op(s1, key); s2 = op(s2, key); s3 = op(s3, key);
+#define AES_ROUND_X8(op, key)                                           \
+  AES_ROUND_X4(op, key)                                                 \
+  s4 = op(s4, key); s5 = op(s5, key); s6 = op(s6, key); s7 = op(s7, key);
+#define AES_ALL_ROUNDS(ROUND, rk)                                       \
+  ROUND(_mm_xor_si128, rk[0])                                           \
+  ROUND(_mm_aesenc_si128, rk[1])                                        \
+  ROUND(_mm_aesenc_si128, rk[2])                                        \
+  ROUND(_mm_aesenc_si128, rk[3])                                        \
+  ROUND(_mm_aesenc_si128, rk[4])                                        \
+  ROUND(_mm_aesenc_si128, rk[5])                                        \
+  ROUND(_mm_aesenc_si128, rk[6])                                        \
+  ROUND(_mm_aesenc_si128, rk[7])                                        \
+  ROUND(_mm_aesenc_si128, rk[8])                                        \
+  ROUND(_mm_aesenc_si128, rk[9])                                        \
+  ROUND(_mm_aesenclast_si128, rk[10])
+
+/// out[j] = encrypt(a[j], b[j], T[j], c[j]) for j < N (4 or 8), with the N
+/// blocks interleaved through the rounds. c may be NULL (zero) and may alias out
+#define AES_KEY_X(j, a, b, T)                                           \
+  block K##j = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi64((a)[j], 1),   \
+                                           _mm_slli_epi64((b)[j], 2)),  \
+                             (T)[j]);                                   \
+  block s##j = K##j;
+#define AES_OUT_X(j, c, out)                                            \
+  s##j = _mm_xor_si128(s##j, K##j);                                     \
+  (out)[j] = (c) == NULL ? s##j : _mm_xor_si128(s##j, (c)[j]);
+#define AES_ENCRYPT_X4(a, b, T, c, out)                                 \
+  do {                                                                  \
+    AES_KEY_X(0, a, b, T) AES_KEY_X(1, a, b, T)                         \
+    AES_KEY_X(2, a, b, T) AES_KEY_X(3, a, b, T)                         \
+    AES_ALL_ROUNDS(AES_ROUND_X4, m_rndkeys)                             \
+    AES_OUT_X(0, c, out) AES_OUT_X(1, c, out)                           \
+    AES_OUT_X(2, c, out) AES_OUT_X(3, c, out)                           \
+  } while (0)
+#define AES_ENCRYPT_X8(a, b, T, c, out)                                 \
+  do {                                                                  \
+    AES_KEY_X(0, a, b, T) AES_KEY_X(1, a, b, T)                         \
+    AES_KEY_X(2, a, b, T) AES_KEY_X(3, a, b, T)                         \
+    AES_KEY_X(4, a, b, T) AES_KEY_X(5, a, b, T)                         \
+    AES_KEY_X(6, a, b, T) AES_KEY_X(7, a, b, T)                         \
+    AES_ALL_ROUNDS(AES_ROUND_X8, m_rndkeys)                             \
+    AES_OUT_X(0, c, out) AES_OUT_X(1, c, out)                           \
+    AES_OUT_X(2, c, out) AES_OUT_X(3, c, out)                           \
+    AES_OUT_X(4, c, out) AES_OUT_X(5, c, out)                           \
+    AES_OUT_X(6, c, out) AES_OUT_X(7, c, out)                           \
+  } while (0)
+
 namespace gashgc {
 
   /**
@@ -100,6 +155,117 @@ namespace gashgc {
    */
   block decrypt(block a, block b, block T, block cipher, block key);
 
+  /**
+   * Fixed-key AES
+   *
+   * Holds the expanded round keys so that garbling and evaluation pay for the
+   * key schedule once per session instead of once per garbled row.
+   *
+   */
+  class FixedKeyAES {
+  public:
+
+    block m_rndkeys[11];
+
+    /**
+     * Construct with the global garbling key
+     *
+     */
+    FixedKeyAES();
+
+    /**
+     * Construct with key `key`
+     *
+     * @param key
+     */
+    FixedKeyAES(block key);
+
+    /**
+     * Encrypt a 128-bit block
+     *
+     * @param msg
+     *
+     * @return
+     */
+    inline block encrypt128(block msg) const {
+      block s0 = msg;
+      AES_ALL_ROUNDS(AES_ROUND_X1, m_rndkeys)
+      return s0;
+    }
+
+    /**
+     * Same as encrypt(a, b, T, c, key) with the fixed key
+     *
+     * @param a
+     * @param b
+     * @param T
+     * @param c
+     *
+     * @return
+     */
+    inline block encrypt(block a, block b, block T, block c) const {
+      block K = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi64(a, 1),
+                                            _mm_slli_epi64(b, 2)),
+                              T);
+      return _mm_xor_si128(_mm_xor_si128(encrypt128(K), K), c);
+    }
+
+    /**
+     * Same as decrypt(a, b, T, cipher, key) with the fixed key
+     *
+     * @param a
+     * @param b
+     * @param T
+     * @param cipher
+     *
+     * @return
+     */
+    inline block decrypt(block a, block b, block T, block cipher) const {
+      return encrypt(a, b, T, cipher);
+    }
+
+    /**
+     * Same as `n` calls to encrypt(a[i], b[i], T[i], c[i]). Up to AES_BATCH_SZ
+     * independent blocks are interleaved through the rounds so that the AES
+     * unit's pipeline stays busy
+     *
+     * @param a
+     * @param b
+     * @param T
+     * @param c The plaintext labels, NULL means all zero
+     * @param out
+     * @param n
+     */
+    inline void encrypt_n(const block* a, const block* b, const block* T,
+                          const block* c, block* out, u32 n) const {
+      u32 i = 0;
+      for (; i + 8 <= n; i += 8) {
+        AES_ENCRYPT_X8(a + i, b + i, T + i, c == NULL ? NULL : c + i, out + i);
+      }
+      for (; i + 4 <= n; i += 4) {
+        AES_ENCRYPT_X4(a + i, b + i, T + i, c == NULL ? NULL : c + i, out + i);
+      }
+      for (; i < n; i++) {
+        out[i] = encrypt(a[i], b[i], T[i], c == NULL ? _mm_setzero_si128() : c[i]);
+      }
+    }
+
+    /**
+     * Same as `n` calls to decrypt(a[i], b[i], T[i], cipher[i])
+     *
+     * @param a
+     * @param b
+     * @param T
+     * @param cipher
+     * @param out
+     * @param n
+     */
+    inline void decrypt_n(const block* a, const block* b, const block* T,
+                          const block* cipher, block* out, u32 n) const {
+      encrypt_n(a, b, T, cipher, out, n);
+    }
+  };
+
 }
 
 #endif
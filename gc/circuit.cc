@@ -17,8 +17,14 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "circuit.hh"
 #include "util.hh"
+#include "../include/bcirc.hh"
 
 namespace gashgc {
 
@@ -110,6 +116,11 @@ namespace gashgc {
     int build_circuit(string circ_file_path, Circuit& circ)
     {
 
+        if (is_bcirc(circ_file_path)) {
+            WARNING("Binary circuit file " << circ_file_path << " can only be loaded as a FlatCircuit");
+            return -G_EINVAL;
+        }
+
         ifstream file(circ_file_path);
 
         if (!file.is_open()) {
@@ -254,7 +265,7 @@ namespace gashgc {
 
               perror("Items have invalid length!\n");
               perror("Items:\n");
-              for (int i = 0; i < items.size(); i++) {
+              for (size_t i = 0; i < items.size(); i++) {
                 cerr << items[i] << endl;
               }
               cerr << "line:" << line << endl;
@@ -267,4 +278,616 @@ namespace gashgc {
         return 0;
     }
 
+    /**
+     * Flat Circuit
+     *
+     */
+
+    u32 FlatCircuit::add_wire(u32 id)
+    {
+        if (id >= m_wire_idx.size()) {
+            m_wire_idx.resize(id + 1, FLAT_NO_WIRE);
+        }
+
+        if (m_wire_idx[id] == FLAT_NO_WIRE) {
+            m_wire_idx[id] = m_nwire;
+            m_wire_id.emplace_back(id);
+            if ((m_nwire & 63) == 0) {
+                m_inv.emplace_back(0);
+            }
+            m_nwire++;
+        }
+
+        return m_wire_idx[id];
+    }
+
+    void FlatCircuit::add_gate(u32 out, int func, u32 in0, u32 in1)
+    {
+        m_in0.emplace_back(in0);
+        m_in1.emplace_back(in1);
+        m_out.emplace_back(out);
+        m_func.emplace_back((u8)func);
+        m_ngate++;
+        if (func != funcXOR) {
+            m_nnonxor++;
+        }
+    }
+
+    int FlatCircuit::topo_sort()
+    {
+        vector<u32> driver(m_nwire, FLAT_NO_WIRE);
+        vector<bool> is_in(m_nwire, false);
+        vector<u32> npending(m_ngate, 0);
+        vector<u32> fanout_start(m_ngate + 1, 0);
+        vector<u32> fanout;
+        vector<u32> order;
+        u32 g, d, head;
+
+        for (u32 idx : m_in_idx) {
+            is_in[idx] = true;
+        }
+
+        for (g = 0; g < m_ngate; g++) {
+            driver[m_out[g]] = g;
+        }
+
+        // Count the predecessors of every gate and the fanout of every driver
+        for (g = 0; g < m_ngate; g++) {
+            for (u32 in : { m_in0[g], m_in1[g] }) {
+                d = driver[in];
+                if (d != FLAT_NO_WIRE) {
+                    npending[g]++;
+                    fanout_start[d + 1]++;
+                } else if (!is_in[in]) {
+                    WARNING("Wire " << m_wire_id[in] << " is neither an input nor driven by any gate");
+                    return -G_EINVAL;
+                }
+            }
+        }
+
+        for (g = 0; g < m_ngate; g++) {
+            fanout_start[g + 1] += fanout_start[g];
+        }
+
+        fanout.resize(fanout_start[m_ngate]);
+        vector<u32> fill(fanout_start.begin(), fanout_start.end() - 1);
+        for (g = 0; g < m_ngate; g++) {
+            for (u32 in : { m_in0[g], m_in1[g] }) {
+                d = driver[in];
+                if (d != FLAT_NO_WIRE) {
+                    fanout[fill[d]++] = g;
+                }
+            }
+        }
+
+        // Kahn's algorithm, seeded in file order
+        order.reserve(m_ngate);
+        for (g = 0; g < m_ngate; g++) {
+            if (npending[g] == 0) {
+                order.emplace_back(g);
+            }
+        }
+
+        for (head = 0; head < order.size(); head++) {
+            g = order[head];
+            for (u32 i = fanout_start[g]; i < fanout_start[g + 1]; i++) {
+                if (--npending[fanout[i]] == 0) {
+                    order.emplace_back(fanout[i]);
+                }
+            }
+        }
+
+        if (order.size() != m_ngate) {
+            WARNING("Circuit has a cycle");
+            return -G_EINVAL;
+        }
+
+        permute_gates(order);
+
+        return 0;
+    }
+
+    void FlatCircuit::levelize()
+    {
+        vector<u32> wire_lvl(m_nwire, 0);
+        vector<u32> gate_lvl(m_ngate);
+        IdVec order(m_ngate);
+        u32 g, l;
+
+        m_nlevel = 0;
+        for (g = 0; g < m_ngate; g++) {
+            l = std::max(wire_lvl[m_in0[g]], wire_lvl[m_in1[g]]);
+            wire_lvl[m_out[g]] = l + 1;
+            gate_lvl[g] = l;
+            m_nlevel = std::max(m_nlevel, l + 1);
+        }
+
+        // Counting sort, stable within a level
+        m_level_start.assign(m_nlevel + 1, 0);
+        for (g = 0; g < m_ngate; g++) {
+            m_level_start[gate_lvl[g] + 1]++;
+        }
+        for (l = 0; l < m_nlevel; l++) {
+            m_level_start[l + 1] += m_level_start[l];
+        }
+
+        IdVec fill(m_level_start.begin(), m_level_start.end() - 1);
+        for (g = 0; g < m_ngate; g++) {
+            order[fill[gate_lvl[g]]++] = g;
+        }
+
+        permute_gates(order);
+    }
+
+    void FlatCircuit::permute_gates(const IdVec& order)
+    {
+        IdVec in0(m_ngate), in1(m_ngate), out(m_ngate);
+        vector<u8> func(m_ngate);
+        for (u32 g = 0; g < m_ngate; g++) {
+            in0[g] = m_in0[order[g]];
+            in1[g] = m_in1[order[g]];
+            out[g] = m_out[order[g]];
+            func[g] = m_func[order[g]];
+        }
+        m_in0.swap(in0);
+        m_in1.swap(in1);
+        m_out.swap(out);
+        m_func.swap(func);
+    }
+
+    void FlatCircuit::clear()
+    {
+        IdVec().swap(m_in0);
+        IdVec().swap(m_in1);
+        IdVec().swap(m_out);
+        vector<u8>().swap(m_func);
+        IdVec().swap(m_level_start);
+        vector<u64>().swap(m_inv);
+        IdVec().swap(m_wire_id);
+        IdVec().swap(m_wire_idx);
+        IdVec().swap(m_in_idx);
+        m_in_id_set.clear();
+        m_out_id_set.clear();
+        m_out_id_vec.clear();
+        m_out_const_map.clear();
+        m_nin = m_nout = m_ngate = m_nwire = m_nnonxor = m_nlevel = 0;
+    }
+
+    /**
+     * Turns the records of a circuit file, text or binary, into a FlatCircuit
+     *
+     */
+    class FlatCircuitBuilder {
+    public:
+
+        /// Record being added, for warnings
+        u32 m_linum = 0;
+        const char* m_unit = "Line";
+
+        FlatCircuitBuilder(FlatCircuit& circ) : m_circ(circ) {}
+
+        /**
+         * Prologue: number of variables, inputs and outputs
+         *
+         */
+        void prologue(u32 nvar, u32 nin, u32 nout)
+        {
+            m_circ.m_nin = nin;
+            m_circ.m_nout = nout;
+
+            m_circ.m_wire_idx.reserve(nvar + 1);
+            m_circ.m_wire_id.reserve(nvar + 1);
+            m_inv_times.reserve(nvar + 1);
+            m_used_as_in.reserve(nvar + 1);
+        }
+
+        /**
+         * Make room for `ngate` gates, when the count is known up front
+         *
+         */
+        void reserve_gates(u32 ngate)
+        {
+            m_circ.m_in0.reserve(ngate);
+            m_circ.m_in1.reserve(ngate);
+            m_circ.m_out.reserve(ngate);
+            m_circ.m_func.reserve(ngate);
+        }
+
+        /**
+         * Input wire, `idx` as in the file (id * 2 + inverted)
+         *
+         * @return 0 if success, -G_EEXIST if the wire is already in the circuit
+         */
+        int input(u32 idx)
+        {
+            u32 id = idx / 2;
+
+            if (m_circ.get_idx(id) != FLAT_NO_WIRE) {
+                return -G_EEXIST;
+            }
+
+            m_driven[new_wire(id, is_odd(idx))] = true;
+            m_circ.m_in_id_set.emplace(id);
+            return 0;
+        }
+
+        /**
+         * Output wire, `val` is its constant value or negative
+         *
+         */
+        void output(u32 idx, int val)
+        {
+            u32 id = idx / 2;
+
+            // An output line never overrides a wire that already exists
+            if (m_circ.get_idx(id) == FLAT_NO_WIRE) {
+                new_wire(id, is_odd(idx));
+                if (val >= 0) {
+                    m_out_val_map.emplace(id, val);
+                }
+            }
+
+            m_circ.m_out_id_set.emplace(id);
+            m_circ.m_out_id_vec.emplace_back(id);
+        }
+
+        /**
+         * Gate, wires as in the file
+         *
+         * @return 0 if success, otherwise errno is returned
+         */
+        int gate(u32 outidx, int func, u32 in0idx, u32 in1idx)
+        {
+            u32 in0, in1, out;
+
+            if (func > 16) {
+                WARNING(m_unit << " " << m_linum << "-Invalid gate function " << func);
+                return -G_EINVAL;
+            }
+
+            if (is_odd(outidx)) {
+                WARNING(m_unit << " " << m_linum << "-Invalid output wire, output wire cannot have odd index");
+                return -G_EINVAL;
+            }
+
+            out = new_wire(outidx / 2, false);
+            if (m_driven[out]) {
+                WARNING("Gate is already in the circuit");
+                return -G_EEXIST;
+            }
+
+            REQUIRE_GOOD_STATUS(use_wire(in0idx / 2, is_odd(in0idx), in0));
+            REQUIRE_GOOD_STATUS(use_wire(in1idx / 2, is_odd(in1idx), in1));
+
+            m_driven[out] = true;
+            m_circ.add_gate(out, func, in0, in1);
+            return 0;
+        }
+
+        /**
+         * Order inputs, resolve constant outputs, sort and levelize the gates
+         *
+         * @return 0 if success, otherwise errno is returned
+         */
+        int finish()
+        {
+            // Inputs are labelled in ascending id order
+            for (u32 in_id : m_circ.m_in_id_set) {
+                m_circ.m_in_idx.emplace_back(m_circ.get_idx(in_id));
+            }
+
+            // Output constants are resolved against the final inversion flag
+            for (auto& it : m_out_val_map) {
+                int val = it.second ^ (m_circ.get_inv(m_circ.get_idx(it.first)) ? 1 : 0);
+                if (val == 0 || val == 1) {
+                    m_circ.m_out_const_map.emplace(it.first, val == 1);
+                }
+            }
+
+            if (m_need_sort) {
+                REQUIRE_GOOD_STATUS(m_circ.topo_sort());
+            }
+
+            m_circ.levelize();
+
+            return 0;
+        }
+
+    private:
+
+        FlatCircuit& m_circ;
+
+        bool m_need_sort = false;
+        vector<u8> m_inv_times;     // Same bookkeeping as WireInstance::m_inv_times
+        vector<u8> m_used_as_in;    // 0: unused, 1: used uninverted, 2: used inverted
+        vector<bool> m_driven;
+        map<u32, int> m_out_val_map;
+
+        u32 new_wire(u32 wid, bool inv)
+        {
+            u32 widx = m_circ.add_wire(wid);
+            if (widx == m_inv_times.size()) {
+                m_inv_times.emplace_back(0);
+                m_used_as_in.emplace_back(0);
+                m_driven.emplace_back(false);
+                m_circ.set_inv(widx, inv);
+            }
+            return widx;
+        }
+
+        int use_wire(u32 wid, bool inv, u32& widx)
+        {
+            // A wire driven by a later gate is allocated here, topo_sort() checks it gets driven
+            widx = new_wire(wid, false);
+            if (m_used_as_in[widx] != 0 && m_used_as_in[widx] != (inv ? 2 : 1)) {
+                WARNING(m_unit << " " << m_linum << "-Cannot use a wire in both inverted and uninverted state.");
+                return -G_EINVAL;
+            }
+            m_used_as_in[widx] = inv ? 2 : 1;
+            if (m_circ.get_inv(widx) != inv) {
+                if (++m_inv_times[widx] > 2) {
+                    FATAL("A Wireinstance's can only be invert twice, firstly as an output  \
+        wire (during initialzation), once as an input wire (during              \
+        reference).");
+                }
+                m_circ.set_inv(widx, inv);
+            }
+            if (!m_driven[widx]) {
+                m_need_sort = true;
+            }
+            return 0;
+        }
+    };
+
+    bool is_bcirc(string circ_file_path)
+    {
+        u32 magic = 0;
+        int fd = open(circ_file_path.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            return false;
+        }
+
+        bool ret = read(fd, &magic, sizeof(u32)) == sizeof(u32) && magic == bcirc_magic_num;
+        close(fd);
+        return ret;
+    }
+
+    /**
+     * Build flat circuit from a binary circuit file, which is mapped and read
+     * in place
+     *
+     * @param circ_file_path
+     * @param circ
+     *
+     * @return 0 if success, otherwise errno is returned
+     */
+    static int build_circuit_bin(string circ_file_path, FlatCircuit& circ)
+    {
+        FlatCircuitBuilder builder(circ);
+        struct stat st;
+        const BcircHeader* hdr;
+        const u32* in = NULL;
+        const BcircOutput* outs = NULL;
+        const BcircGate* gates = NULL;
+        u64 hash;
+        u64 nword;
+        void* base;
+        int ret = 0;
+
+        int fd = open(circ_file_path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            FATAL("Unable to open circuit file " << circ_file_path);
+        }
+
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BcircHeader) + sizeof(u64)) {
+            close(fd);
+            WARNING("Binary circuit file " << circ_file_path << " is truncated");
+            return -G_EINVAL;
+        }
+
+        base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            WARNING("Unable to map circuit file " << circ_file_path);
+            return -G_EINVAL;
+        }
+        madvise(base, st.st_size, MADV_SEQUENTIAL);
+
+        hdr = (const BcircHeader*)base;
+
+        // Size the tables in 64 bits before pointing into them, the counts
+        // come straight from the file
+        nword = (sizeof(BcircHeader) + hdr->m_nin_rec * (u64)sizeof(u32)
+                 + hdr->m_nout_rec * (u64)sizeof(BcircOutput)
+                 + hdr->m_ngate * (u64)sizeof(BcircGate)) / sizeof(u32);
+
+        if (hdr->m_version != BCIRC_VERSION) {
+            WARNING("Unsupported binary circuit version " << hdr->m_version);
+            ret = -G_EINVAL;
+        } else if (nword * sizeof(u32) + sizeof(u64) != (u64)st.st_size) {
+            WARNING("Binary circuit file " << circ_file_path << " has the wrong size");
+            ret = -G_EINVAL;
+        } else {
+            in = (const u32*)(hdr + 1);
+            outs = (const BcircOutput*)(in + hdr->m_nin_rec);
+            gates = (const BcircGate*)(outs + hdr->m_nout_rec);
+
+            hash = bcirc_hash(BCIRC_HASH_INIT, (const u32*)base, nword);
+            if (memcmp(&hash, (const u32*)base + nword, sizeof(u64)) != 0) {
+                WARNING("Binary circuit file " << circ_file_path << " is corrupted, checksum mismatch");
+                ret = -G_EINVAL;
+            }
+        }
+
+        if (ret == 0) {
+            builder.m_unit = "Gate";
+            builder.prologue(hdr->m_nvar, hdr->m_nin, hdr->m_nout);
+            builder.reserve_gates(hdr->m_ngate);
+
+            for (u32 i = 0; ret == 0 && i < hdr->m_nin_rec; i++) {
+                ret = builder.input(in[i]);
+            }
+
+            for (u32 i = 0; ret == 0 && i < hdr->m_nout_rec; i++) {
+                builder.output(outs[i].m_idx, outs[i].m_val == BCIRC_NO_VAL ? -1 : (int)outs[i].m_val);
+            }
+
+            for (u32 i = 0; ret == 0 && i < hdr->m_ngate; i++) {
+                builder.m_linum = i;
+                ret = builder.gate(gates[i].m_out, gates[i].m_func, gates[i].m_in0, gates[i].m_in1);
+            }
+        }
+
+        munmap(base, st.st_size);
+
+        REQUIRE_GOOD_STATUS(ret);
+        return builder.finish();
+    }
+
+    int build_circuit(string circ_file_path, FlatCircuit& circ)
+    {
+
+        if (is_bcirc(circ_file_path)) {
+            return build_circuit_bin(circ_file_path, circ);
+        }
+
+        ifstream file(circ_file_path);
+
+        if (!file.is_open()) {
+            FATAL("Unable to open circuit file " << circ_file_path);
+        }
+
+        FlatCircuitBuilder builder(circ);
+        string line;
+        u32 idx;
+        vector<string> items;
+        vector<string> subitems;
+        const char* delim = " ";
+        const char* subdelim = ":";
+
+        while (getline(file, line)) {
+
+            builder.m_linum++;
+            items.clear();
+            subitems.clear();
+            split(line, delim, items);
+
+            if (items.size() == 0)
+                continue;
+
+            // Skip directives
+            if (items[0].find('#') != std::string::npos)
+                continue;
+
+            switch (items.size()) {
+            case 8: {
+                // Prologue line
+                builder.prologue(stoi(items[1]), stoi(items[2]), stoi(items[3]));
+                break;
+            }
+            case 1: {
+                // Input example:    I:14
+                // Output example:   O:309,  O:309:1
+
+                split(items[0], subdelim, subitems);
+
+                idx = stoi(subitems[1]);
+
+                if (strcmp("I", subitems[0].c_str()) == 0) {
+
+                    if (subitems.size() > 2) {
+                        WARNING("Invalid input wire, expecting 2 item, getting " << subitems.size() << " items");
+                    }
+
+                    REQUIRE_GOOD_STATUS(builder.input(idx));
+
+                } else if (strcmp("O", subitems[0].c_str()) == 0) {
+                    builder.output(idx, subitems.size() == 3 ? stoi(subitems[2]) : -1);
+                }
+
+                break;
+            }
+            case 4: {
+                // Gate:       <out> <func> <in0> <in1>, e.g. 67 14 69 13
+                REQUIRE_GOOD_STATUS(builder.gate(stoi(items[0]), stoi(items[1]), stoi(items[2]), stoi(items[3])));
+                break;
+            }
+            default:
+
+              perror("Items have invalid length!\n");
+              perror("Items:\n");
+              for (size_t i = 0; i < items.size(); i++) {
+                cerr << items[i] << endl;
+              }
+              cerr << "line:" << line << endl;
+              abort();
+            }
+        }
+
+        return builder.finish();
+    }
+
+    int replicate_circuit(const FlatCircuit& circ, u32 n, FlatCircuit& out)
+    {
+        u32 stride = circ.m_wire_idx.size();
+        u32 nwire = circ.m_nwire;
+        u32 idx;
+
+        // Circuit and data files carry 2 * id, the data file as an int
+        if (n == 0 || (u64)stride * n * 2 > INT32_MAX) {
+            WARNING("Cannot replicate circuit " << n << " times, wire ids overflow");
+            return -G_EINVAL;
+        }
+
+        out.clear();
+        out.m_wire_idx.reserve((u64)stride * n);
+        out.m_wire_id.reserve((u64)nwire * n);
+
+        // Wires of copy k are idx + k * nwire, with id + k * stride
+        for (u32 k = 0; k < n; k++) {
+            for (idx = 0; idx < nwire; idx++) {
+                out.add_wire(circ.m_wire_id[idx] + k * stride);
+                out.set_inv(idx + k * nwire, (circ.m_inv[idx >> 6] >> (idx & 63)) & 1);
+            }
+        }
+
+        // Level l of the copy is the copies of level l, so the depth stays the same
+        out.m_level_start.assign(circ.m_nlevel + 1, 0);
+        for (u32 l = 0; l < circ.m_nlevel; l++) {
+            for (u32 k = 0; k < n; k++) {
+                for (u32 g = circ.m_level_start[l]; g < circ.m_level_start[l + 1]; g++) {
+                    out.add_gate(circ.m_out[g] + k * nwire, circ.m_func[g],
+                                 circ.m_in0[g] + k * nwire, circ.m_in1[g] + k * nwire);
+                }
+            }
+            out.m_level_start[l + 1] = out.m_ngate;
+        }
+        out.m_nlevel = circ.m_nlevel;
+
+        // Copies are in ascending id order, so input indices stay sorted by id
+        for (u32 k = 0; k < n; k++) {
+            for (u32 in_idx : circ.m_in_idx) {
+                out.m_in_idx.emplace_back(in_idx + k * nwire);
+            }
+            for (u32 id : circ.m_in_id_set) {
+                out.m_in_id_set.emplace(id + k * stride);
+            }
+            for (u32 id : circ.m_out_id_set) {
+                out.m_out_id_set.emplace(id + k * stride);
+            }
+            for (u32 id : circ.m_out_id_vec) {
+                out.m_out_id_vec.emplace_back(id + k * stride);
+            }
+            for (auto& it : circ.m_out_const_map) {
+                out.m_out_const_map.emplace(it.first + k * stride, it.second);
+            }
+        }
+
+        out.m_nin = circ.m_nin * n;
+        out.m_nout = circ.m_nout * n;
+
+        return 0;
+    }
+
 } // namespace gashgc
@@ -36,6 +36,8 @@ namespace gashgc {
   typedef vector<u32> IdVec;
   typedef map<u32, bool> IdBoolMap;
 
+#define FLAT_NO_WIRE 0xFFFFFFFF
+
 
   /**
    * Circuit
@@ -255,6 +257,151 @@ namespace gashgc {
       : m_func(func), m_in0(in0), m_in1(in1), m_out(out) {}
   };
 
+  /**
+   * Flat Circuit
+   *
+   * Structure-of-arrays form of Circuit. Wires are renumbered densely in
+   * [0, m_nwire), gates are kept in topological order in parallel arrays, and
+   * the inversion flag of every wire is packed into a bit vector. Nothing is
+   * allocated per wire or per gate.
+   *
+   */
+  class FlatCircuit {
+  public:
+
+    u32 m_nin;
+
+    u32 m_nout;
+
+    u32 m_ngate;
+
+    u32 m_nwire;
+
+    u32 m_nnonxor;      // Number of gates that need a garbled table
+
+    u32 m_nlevel;       // Depth of the circuit
+
+    /// Gate arrays, indexed by gate, in topological order. Wires are dense indices.
+    IdVec m_in0;
+    IdVec m_in1;
+    IdVec m_out;
+    vector<u8> m_func;
+
+    /// Gates of level l are [m_level_start[l], m_level_start[l + 1]), gates in
+    /// the same level do not depend on each other
+    IdVec m_level_start;
+
+    /// One bit per dense wire index, set if the wire is inverted
+    vector<u64> m_inv;
+
+    /// Dense index -> wire id, and wire id -> dense index (FLAT_NO_WIRE if unused)
+    IdVec m_wire_id;
+    IdVec m_wire_idx;
+
+    /// Dense indices of the input wires, in ascending wire id order
+    IdVec m_in_idx;
+
+    IdSet m_in_id_set;
+
+    IdSet m_out_id_set;
+    IdVec m_out_id_vec;
+
+    /// Output wire id -> value, only for constant outputs
+    IdBoolMap m_out_const_map;
+
+    FlatCircuit() : m_nin(0), m_nout(0), m_ngate(0), m_nwire(0), m_nnonxor(0), m_nlevel(0) {}
+
+    /**
+     * Get the dense index of wire `id`, allocating one if the wire is new
+     *
+     * @param id
+     *
+     * @return
+     */
+    u32 add_wire(u32 id);
+
+    /**
+     * Get the dense index of wire `id`
+     *
+     * @param id
+     *
+     * @return The index, or FLAT_NO_WIRE if the wire is not in the circuit
+     */
+    inline u32 get_idx(u32 id) {
+      return id < m_wire_idx.size() ? m_wire_idx[id] : FLAT_NO_WIRE;
+    }
+
+    /**
+     * Get invertibility of wire with dense index `idx`
+     *
+     * @param idx
+     *
+     * @return
+     */
+    inline bool get_inv(u32 idx) {
+      return (m_inv[idx >> 6] >> (idx & 63)) & 1;
+    }
+
+    /**
+     * Set invertibility of wire with dense index `idx`
+     *
+     * @param idx
+     * @param inv
+     */
+    inline void set_inv(u32 idx, bool inv) {
+      if (inv) {
+        m_inv[idx >> 6] |= (u64)1 << (idx & 63);
+      } else {
+        m_inv[idx >> 6] &= ~((u64)1 << (idx & 63));
+      }
+    }
+
+    /**
+     * Append a gate, wires are given as dense indices
+     *
+     * @param out
+     * @param func
+     * @param in0
+     * @param in1
+     */
+    void add_gate(u32 out, int func, u32 in0, u32 in1);
+
+    /**
+     * Reorder the gates topologically, keeping the file order where possible
+     *
+     * @return 0 if success, -G_EINVAL if the circuit has a cycle or an undriven wire
+     */
+    int topo_sort();
+
+    /**
+     * Stably reorder topologically sorted gates by level and fill m_level_start
+     *
+     */
+    void levelize();
+
+    /**
+     * Reorder the gates so that gate i becomes gate order[i]
+     *
+     * @param order
+     */
+    void permute_gates(const IdVec& order);
+
+    /**
+     * Release all storage
+     *
+     */
+    void clear();
+  };
+
+  /**
+   * Check whether a circuit file is in the binary format of include/bcirc.hh
+   *
+   * @param circ_file_path
+   *
+   * @return
+   */
+  bool is_bcirc(string circ_file_path);
+
   /**
    * Build circuit from circuit file
    *
@@ -263,6 +410,28 @@ namespace gashgc {
    */
   int build_circuit(string circ_file_path, Circuit& circ);
 
+  /**
+   * Build flat circuit from circuit file, text or binary. A binary file is
+   * mapped and its records are read in place
+   *
+   * @param circ_file_path
+   * @param circ
+   */
+  int build_circuit(string circ_file_path, FlatCircuit& circ);
+
+  /**
+   * Build `n` independent copies of a flat circuit side by side. Copy k has
+   * wire ids shifted by k * circ.m_wire_idx.size() and its gates share the
+   * levels of the original, so the copies are garbled together
+   *
+   * @param circ
+   * @param n
+   * @param out
+   *
+   * @return 0 if success, -G_EINVAL if the wire ids do not fit
+   */
+  int replicate_circuit(const FlatCircuit& circ, u32 n, FlatCircuit& out);
+
 }
 
 #endif
@@ -21,13 +21,12 @@
 
 #include "aes.hh"
 #include "ot.hh"
+#include "otpool.hh"
 #include "tcp.hh"
 #include "util.hh"
 
 namespace gashgc {
 
-    extern block AESkey;
-
     Evaluator::Evaluator(string peer_ip, u16 port, u16 ot_port, string circ_file_path, string input_file_path)
     {
         m_peer_ip = peer_ip;
@@ -39,6 +38,13 @@ namespace gashgc {
 
     int Evaluator::build_circ()
     {
+        if (m_flat) {
+            return build_circuit(m_circ_fpath, m_fc);
+        }
+        if (m_scheme != GC_GRR3) {
+            WARNING("Half gates garbling requires the flat circuit");
+            return -G_EINVAL;
+        }
         return build_circuit(m_circ_fpath, m_c);
     }
 
@@ -59,6 +65,15 @@ namespace gashgc {
         GWI* gw;
         GG* gg;
 
+        if (m_flat) {
+            if (m_stream) {
+                m_fgc.alloc_stream(m_fc, m_scheme);
+            } else {
+                m_fgc.alloc(m_fc, m_scheme);
+            }
+            return 0;
+        }
+
         for (auto it = m_c.m_gate_map.begin(); it != m_c.m_gate_map.end(); ++it) {
 
             g = it->second;
@@ -126,7 +141,7 @@ namespace gashgc {
 
                 size = stoi(items[1]);
                 m_n_self_in = size;
-                m_n_peer_in = m_c.m_nin - size;
+                m_n_peer_in = (m_flat ? m_fc.m_nin : m_c.m_nin) - size;
 
                 continue;
             }
@@ -180,6 +195,12 @@ namespace gashgc {
         u32 id;
         int select;
 
+        const FixedKeyAES& aes = m_aes;
+
+        if (m_flat) {
+            return evaluate_flat_circ();
+        }
+
         for (auto it = m_gc.m_gg_map.begin(); it != m_gc.m_gg_map.end(); ++it) {
 
             id = it->first;
@@ -208,15 +229,14 @@ namespace gashgc {
                 if (select == 0) {
 
                     // Use the same encryption as in garbling to get the label
-                    lbl = encrypt(gin0->get_lbl(), gin1->get_lbl(), tweak, ZERO, AESkey);
+                    lbl = aes.encrypt(gin0->get_lbl(), gin1->get_lbl(), tweak, ZERO);
 
                 } else {
 
-                    lbl = decrypt(gin0->get_lbl(),
+                    lbl = aes.decrypt(gin0->get_lbl(),
                         gin1->get_lbl(),
                         tweak,
-                        gg->m_egtt->get_row(select),
-                        AESkey);
+                        gg->m_egtt->get_row(select));
                 }
             }
 
@@ -226,6 +246,234 @@ namespace gashgc {
         return 0;
     }
 
+    int Evaluator::evaluate_flat_circ(bool stream)
+    {
+
+        FlatCircuit& c = m_fc;
+        const block* tbl = m_fgc.m_tbl.data();
+        const block* tbl_end = stream ? tbl : tbl + m_fgc.m_tbl.size();
+        u32 nleft = c.m_nnonxor;        // Non-XOR gates whose tables are still on the wire
+        u32 nchunk;
+        u32 nrow = m_fgc.m_nrow;
+        u32 g, g1, end;
+        u32 room;
+
+        if (m_nthread > 1 && (m_pool == NULL || m_pool->size() != m_nthread)) {
+            delete m_pool;
+            m_pool = new WorkerPool(m_nthread);
+        }
+
+        for (auto it = m_in_lbl_map.begin(); it != m_in_lbl_map.end(); ++it) {
+            REQUIRE_GOOD_STATUS(m_fgc.set_gwl(c, it->first, it->second));
+        }
+
+        for (u32 l = 0; l < c.m_nlevel; l++) {
+
+            g = c.m_level_start[l];
+            end = c.m_level_start[l + 1];
+
+            if (!stream) {
+                if (m_nthread > 1 && end - g >= 2 * FLAT_TASK_SZ) {
+                    tbl = evaluate_flat_level(g, end, tbl);
+                } else {
+                    tbl = evaluate_flat_gates(g, end, tbl);
+                }
+                continue;
+            }
+
+            // Evaluate as many gates as the chunk has tables for, then take the next one
+            while (g < end) {
+
+                if (tbl == tbl_end && nleft > 0) {
+                    nchunk = std::min(nleft, (u32)EGTT_STREAM_CHUNK);
+                    nleft -= nchunk;
+                    tbl = m_fgc.m_tbl.data();
+                    tbl_end = tbl + nrow * nchunk;
+                    REQUIRE_GOOD_STATUS(tcp_recv_bulk(m_peer_sock, (char*)tbl, nrow * nchunk * LABELSIZE));
+                }
+
+                room = (tbl_end - tbl) / nrow;
+                for (g1 = g; g1 < end && (room > 0 || c.m_func[g1] == funcXOR); g1++) {
+                    room -= c.m_func[g1] != funcXOR;
+                }
+
+                tbl = evaluate_flat_gates(g, g1, tbl);
+                g = g1;
+            }
+        }
+
+        return 0;
+    }
+
+    const block* Evaluator::evaluate_flat_gates(u32 g0, u32 g1, const block* tbl)
+    {
+
+        FlatCircuit& c = m_fc;
+        LabelVec& lbl = m_fgc.m_lbl;
+        const FixedKeyAES& aes = m_aes;
+        u32 nrow = m_fgc.m_nrow;
+        bool half = m_fgc.m_scheme == GC_HALF_GATES;
+
+        // AES blocks per non-XOR gate, one per half gate with half gates
+        u32 nblk = half ? 2 : 1;
+
+        block ZERO = getZEROblock();
+        block a;
+        block b;
+
+        int select;
+        int func;
+
+        // split[func] is {and-like, alpha, beta, gamma}, see split_bgate
+        int split[16][4];
+
+        // Non-XOR gates of one level are evaluated AES_BATCH_SZ blocks at a time
+        block ka[AES_BATCH_SZ];
+        block kb[AES_BATCH_SZ];
+        block kt[AES_BATCH_SZ];
+        block kc[AES_BATCH_SZ];
+        block h[AES_BATCH_SZ];
+        u32 batch_out[AES_BATCH_SZ];
+        u32 nbatch = 0;
+
+        auto flush = [&]() {
+            aes.decrypt_n(ka, kb, kt, kc, h, nblk * nbatch);
+            for (u32 i = 0; i < nbatch; i++) {
+                lbl[batch_out[i]] = half ? xor_block(h[2 * i], h[2 * i + 1]) : h[i];
+            }
+            nbatch = 0;
+        };
+
+        for (func = 0; func < 16; func++) {
+            split[func][0] = split_bgate(func, split[func][1], split[func][2], split[func][3]);
+        }
+
+        for (u32 g = g0; g < g1; g++) {
+
+            a = lbl[c.m_in0[g]];
+            b = lbl[c.m_in1[g]];
+            func = c.m_func[g];
+
+            // XOR gate
+            if (func == funcXOR) {
+                lbl[c.m_out[g]] = xor_block(a, b);
+                continue;
+            }
+
+            if (half) {
+
+                // Affine gates are free
+                if (!split[func][0]) {
+                    lbl[c.m_out[g]] = xor_block(split[func][1] ? a : ZERO, split[func][2] ? b : ZERO);
+                    tbl += nrow;
+                    continue;
+                }
+
+                // Garbler half hashes the a slot, evaluator half the b slot
+                ka[2 * nbatch] = a;
+                kb[2 * nbatch] = ZERO;
+                kc[2 * nbatch] = get_lsb(a) ? tbl[0] : ZERO;
+                ka[2 * nbatch + 1] = ZERO;
+                kb[2 * nbatch + 1] = b;
+                kc[2 * nbatch + 1] = get_lsb(b) ? xor_block(tbl[1], a) : ZERO;
+                kt[2 * nbatch] = kt[2 * nbatch + 1] = new_tweak(c.m_wire_id[c.m_out[g]]);
+
+            } else {
+
+                // Non-XOR gate, row 0 is implicit and decrypts from zero
+                select = get_lsb(a) + (get_lsb(b) << 1);
+
+                ka[nbatch] = a;
+                kb[nbatch] = b;
+                kt[nbatch] = new_tweak(c.m_wire_id[c.m_out[g]]);
+                kc[nbatch] = select == 0 ? ZERO : tbl[select - 1];
+            }
+
+            batch_out[nbatch] = c.m_out[g];
+            tbl += nrow;
+
+            if (++nbatch * nblk == AES_BATCH_SZ) {
+                flush();
+            }
+        }
+
+        if (nbatch > 0) {
+            flush();
+        }
+
+        return tbl;
+    }
+
+    const block* Evaluator::evaluate_flat_level(u32 g0, u32 g1, const block* tbl)
+    {
+
+        FlatCircuit& c = m_fc;
+        u32 ntask = (g1 - g0 + FLAT_TASK_SZ - 1) / FLAT_TASK_SZ;
+        vector<const block*> task_tbl(ntask + 1);
+
+        // Every task reads its rows after those of the tasks before it
+        task_tbl[0] = tbl;
+        for (u32 t = 0; t < ntask; t++) {
+            u32 n = 0;
+            for (u32 g = g0 + t * FLAT_TASK_SZ; g < std::min(g1, g0 + (t + 1) * FLAT_TASK_SZ); g++) {
+                n += c.m_func[g] != funcXOR;
+            }
+            task_tbl[t + 1] = task_tbl[t] + n * m_fgc.m_nrow;
+        }
+
+        m_pool->run(ntask, [&](u32 t) {
+            evaluate_flat_gates(g0 + t * FLAT_TASK_SZ, std::min(g1, g0 + (t + 1) * FLAT_TASK_SZ), task_tbl[t]);
+        });
+
+        return task_tbl[ntask];
+    }
+
+    /**
+     * Receive and check the header of a bulk table stream
+     *
+     * @param sock
+     * @param scheme
+     * @param nnonxor
+     *
+     * @return 0 if the garbler streams `nnonxor` tables of `scheme`
+     */
+    static int recv_bulk_hdr(int sock, int scheme, u32 nnonxor)
+    {
+        u32 val;
+
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, (char*)&val, sizeof(u32)));
+        if (val != egtt_bulk_magic_num) {
+            WARNING("Garbler is not streaming the garbled tables in bulk");
+            return -G_EINVAL;
+        }
+
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, (char*)&val, sizeof(u32)));
+        if (val != (scheme == GC_HALF_GATES ? halfgate_magic_num : nonxor_magic_num)) {
+            WARNING("Garbler uses another garbling scheme, magic number: " << val);
+            return -G_EINVAL;
+        }
+
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, (char*)&val, sizeof(u32)));
+        GASSERT(val == nnonxor);
+
+        return 0;
+    }
+
+    int Evaluator::recv_and_evaluate_circ()
+    {
+
+        if (!m_flat || !m_stream) {
+            WARNING("Streaming evaluation requires the flat circuit and m_stream");
+            return -G_EINVAL;
+        }
+
+        REQUIRE_GOOD_STATUS(recv_self_lbls());
+        REQUIRE_GOOD_STATUS(recv_peer_lbls());
+        REQUIRE_GOOD_STATUS(recv_bulk_hdr(m_peer_sock, m_fgc.m_scheme, m_fc.m_nnonxor));
+
+        return evaluate_flat_circ(true);
+    }
+
     int Evaluator::recv_egtt()
     {
 
@@ -237,8 +485,35 @@ namespace gashgc {
         block row2;
         block row3;
 
+        // Position of each gate's rows in the flat table, by dense output wire index
+        vector<u32> tbl_pos;
+        u32 pos;
+
+        // Bulk stream: the rows of all non-XOR gates, in our own gate order
+        if (m_flat && m_bulk_egtt) {
+
+            REQUIRE_GOOD_STATUS(recv_bulk_hdr(m_peer_sock, m_fgc.m_scheme, m_fc.m_nnonxor));
+
+            if (m_fgc.m_tbl.size() > 0) {
+                REQUIRE_GOOD_STATUS(tcp_recv_bulk(m_peer_sock, (char*)m_fgc.m_tbl.data(), m_fgc.m_tbl.size() * LABELSIZE));
+            }
+
+            return 0;
+        }
+
         REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
-        GASSERT(size == m_c.m_ngate); // Assert that peer is sending the same number of gates
+        GASSERT(size == (m_flat ? m_fc.m_ngate : m_c.m_ngate)); // Assert that peer is sending the same number of gates
+
+        if (m_flat) {
+            tbl_pos.assign(m_fc.m_nwire, FLAT_NO_WIRE);
+            pos = 0;
+            for (u32 g = 0; g < m_fc.m_ngate; g++) {
+                if (m_fc.m_func[g] != funcXOR) {
+                    tbl_pos[m_fc.m_out[g]] = pos;
+                    pos += m_fgc.m_nrow;
+                }
+            }
+        }
 
         for (u32 i = 0; i < size; ++i) {
 
@@ -250,13 +525,38 @@ namespace gashgc {
 
                 continue;
 
-            } else if (magic_num == nonxor_magic_num) {
+            } else if (magic_num == halfgate_magic_num && m_flat && m_fgc.m_scheme == GC_HALF_GATES) {
+                // Half gates, receive the garbler half and the evaluator half
+
+                pos = m_fc.get_idx(id);
+                pos = pos == FLAT_NO_WIRE ? FLAT_NO_WIRE : tbl_pos[pos];
+                if (pos == FLAT_NO_WIRE) {
+                    WARNING("Cannot find non-XOR gate for id:" << id);
+                    return -G_ENOENT;
+                }
+                REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&m_fgc.m_tbl[pos], LABELSIZE));
+                REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&m_fgc.m_tbl[pos + 1], LABELSIZE));
+
+            } else if (magic_num == nonxor_magic_num && m_fgc.m_scheme == GC_GRR3) {
                 // Non-xor gates, receive egtt
 
                 REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&row1, LABELSIZE));
                 REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&row2, LABELSIZE));
                 REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&row3, LABELSIZE));
 
+                if (m_flat) {
+                    pos = m_fc.get_idx(id);
+                    pos = pos == FLAT_NO_WIRE ? FLAT_NO_WIRE : tbl_pos[pos];
+                    if (pos == FLAT_NO_WIRE) {
+                        WARNING("Cannot find non-XOR gate for id:" << id);
+                        return -G_ENOENT;
+                    }
+                    m_fgc.m_tbl[pos] = row1;
+                    m_fgc.m_tbl[pos + 1] = row2;
+                    m_fgc.m_tbl[pos + 2] = row3;
+                    continue;
+                }
+
                 gg = m_gc.get_gg(id);
                 GASSERT(gg != NULL);
 
@@ -264,6 +564,7 @@ namespace gashgc {
 
             } else {
 
+                // Also catches a garbler running another garbling scheme
                 WARNING("Invalid magic number: " << magic_num);
                 return -G_EINVAL;
             }
@@ -293,22 +594,36 @@ namespace gashgc {
             REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&lbl0, LABELSIZE));
             REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&lbl1, LABELSIZE));
 
+            val = m_in_val_map.find(id)->second;
+
+            lbl = val == 0 ? lbl0 : lbl1;
+
+            if (m_flat) {
+                if (m_fgc.set_gwl(m_fc, id, lbl) != 0) {
+                    WARNING("Cannot find value for wire id: " << id);
+                    return -G_ENOENT;
+                }
+                continue;
+            }
+
             gw = m_gc.get_gwi(id);
             if (!gw) {
                 WARNING("Cannot find value for wire id: " << id);
                 return -G_ENOENT;
             }
 
-            val = m_in_val_map.find(id)->second;
-
-            lbl = val == 0 ? lbl0 : lbl1;
-
             gw->set_lbl(lbl);
         }
 
         return 0;
     }
 
+    int Evaluator::start_ot_pool(u32 n, u32 batch)
+    {
+        // Labels come in the clear, there is nothing to precompute
+        return 0;
+    }
+
 #else
 
     int Evaluator::recv_self_lbls()
@@ -321,10 +636,48 @@ namespace gashgc {
         REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
         GASSERT(size == m_in_val_map.size());
 
-        OTParty otp;
-        REQUIRE_GOOD_STATUS(otp.OTRecv(m_peer_ip, m_ot_port, m_in_val_map, idlblmap));
+        // Every input may come as a label, see m_in_lbl_map
+        if (size == 0) {
+            return 0;
+        }
+
+        if (m_flat && !m_ot_pool) {
+
+            // Straight into the label storage, in id order as the garbler sends them
+            vector<u8> sel;
+            vector<u32> idx;
+            for (auto it = m_in_val_map.begin(); it != m_in_val_map.end(); ++it) {
+                idx.emplace_back(m_fc.get_idx(it->first));
+                sel.emplace_back(it->second);
+                if (idx.back() == FLAT_NO_WIRE) {
+                    WARNING("Cannot find value for wire id: " << it->first);
+                    return -G_ENOENT;
+                }
+            }
+
+            LabelSink sink = [&](u32 off, const block* lbls, u32 n) {
+                for (u32 i = 0; i < n; ++i) {
+                    m_fgc.m_lbl[idx[off + i]] = lbls[i];
+                }
+            };
+
+            if (m_cot) {
+                return ot_party()->COTRecv(m_peer_ip, m_ot_port, sel, sink);
+            }
+            return ot_party()->OTRecv(m_peer_ip, m_ot_port, sel, sink);
+        }
+
+        if (m_ot_pool) {
+            REQUIRE_GOOD_STATUS(recv_self_lbls_pool(idlblmap));
+        } else {
+            REQUIRE_GOOD_STATUS(ot_party()->OTRecv(m_peer_ip, m_ot_port, m_in_val_map, idlblmap));
+        }
 
         for (auto it = idlblmap.begin(); it != idlblmap.end(); ++it) {
+            if (m_flat) {
+                REQUIRE_GOOD_STATUS(m_fgc.set_gwl(m_fc, it->first, it->second));
+                continue;
+            }
             gw = m_gc.get_gwi(it->first);
             GASSERT(gw != NULL);
             gw->set_lbl(it->second);
@@ -333,6 +686,58 @@ namespace gashgc {
         return 0;
     }
 
+    int Evaluator::recv_self_lbls_pool(map<u32, block>& idlblmap)
+    {
+
+        u32 n = m_in_val_map.size();
+        vector<int> c;
+        LabelVec mc;
+        vector<u8> d(n);
+        vector<block> e(2 * n);
+        u32 i;
+
+        REQUIRE_GOOD_STATUS(m_ot_pool->take(n, c, mc));
+
+        // Ordered by id, as the garbler's labels
+        i = 0;
+        for (auto it = m_in_val_map.begin(); it != m_in_val_map.end(); ++it, ++i) {
+            d[i] = it->second ^ c[i];
+        }
+
+        REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)d.data(), n));
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)e.data(), 2 * n * LABELSIZE));
+
+        i = 0;
+        for (auto it = m_in_val_map.begin(); it != m_in_val_map.end(); ++it, ++i) {
+            idlblmap.emplace(it->first, _mm_xor_si128(e[2 * i + it->second], mc[i]));
+        }
+
+        return 0;
+    }
+
+    OTParty* Evaluator::ot_party()
+    {
+
+        if (!m_ot) {
+            m_ot = new OTParty();
+            m_ot->m_nNumOTThreads = m_ot_nthread;
+        }
+
+        return m_ot;
+    }
+
+    int Evaluator::start_ot_pool(u32 n, u32 batch)
+    {
+
+        delete m_ot_pool;
+        m_ot_pool = new OTPool(ot_party(), 1, m_peer_ip, m_ot_port);
+        m_ot_pool->m_low = batch;
+        m_ot_pool->m_batch = batch;
+        m_ot_pool->fill(n);
+
+        return 0;
+    }
+
 #endif
 
     int Evaluator::recv_peer_lbls()
@@ -351,6 +756,14 @@ namespace gashgc {
             REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&id, sizeof(u32)));
             REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&lbl, LABELSIZE));
 
+            if (m_flat) {
+                if (m_fgc.set_gwl(m_fc, id, lbl) != 0) {
+                    WARNING("Cannot find value for wire id: " << id);
+                    return -G_ENOENT;
+                }
+                continue;
+            }
+
             gw = m_gc.get_gwi(id);
             if (!gw) {
                 WARNING("Cannot find value for wire id: " << id);
@@ -371,6 +784,7 @@ namespace gashgc {
         GWI* gw;
         block lbl0;
         block lbl1;
+        IdSet& out_id_set = m_flat ? m_fc.m_out_id_set : m_c.m_out_id_set;
 
         REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
 
@@ -380,11 +794,19 @@ namespace gashgc {
             REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&lbl0, LABELSIZE));
             REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&lbl1, LABELSIZE));
 
-            if (m_c.m_out_id_set.find(id) == m_c.m_out_id_set.end()) {
+            if (out_id_set.find(id) == out_id_set.end()) {
                 WARNING("Cannot find id in output id set:" << id);
                 return -G_ENOENT;
             }
 
+            if (m_flat) {
+                if (m_fgc.add_out_lbls(m_fc, id, lbl0, lbl1) != 0) {
+                    WARNING("Cannot find value for wire id: " << id);
+                    return -G_ENOENT;
+                }
+                continue;
+            }
+
             gw = m_gc.get_gwi(id);
             if (!gw) {
                 WARNING("Cannot find value for wire id: " << id);
@@ -406,6 +828,30 @@ namespace gashgc {
         WI*  w;
         int val;
 
+        if (m_flat) {
+
+            for (auto it = m_fc.m_out_id_set.begin(); it != m_fc.m_out_id_set.end(); ++it) {
+
+                id = *it;
+
+                // If wire is constant
+                auto const_it = m_fc.m_out_const_map.find(id);
+                if (const_it != m_fc.m_out_const_map.end()) {
+                    m_out_val_map.emplace(id, const_it->second ? 1 : 0);
+                    continue;
+                }
+
+                val = m_fgc.recover_smtc(m_fc, id);
+                if (val < 0) {
+                    return val;
+                }
+
+                m_out_val_map.emplace(id, val);
+            }
+
+            return 0;
+        }
+
         for (auto it = m_c.m_out_id_set.begin(); it != m_c.m_out_id_set.end(); ++it) {
 
             id = *it;
@@ -436,8 +882,9 @@ namespace gashgc {
     {
 
         u32 id;
+        IdVec& out_id_vec = m_flat ? m_fc.m_out_id_vec : m_c.m_out_id_vec;
 
-        for (auto it = m_c.m_out_id_vec.begin(); it != m_c.m_out_id_vec.end(); ++it) {
+        for (auto it = out_id_vec.begin(); it != out_id_vec.end(); ++it) {
             id = *it;
             cout << id << ":" << m_out_val_map.find(id)->second << endl;
         }
@@ -448,7 +895,9 @@ namespace gashgc {
     int Evaluator::get_output(string& str)
     {
         u32 id;
-        for (auto it = m_c.m_out_id_vec.begin(); it != m_c.m_out_id_vec.end(); ++it) {
+        IdVec& out_id_vec = m_flat ? m_fc.m_out_id_vec : m_c.m_out_id_vec;
+
+        for (auto it = out_id_vec.begin(); it != out_id_vec.end(); ++it) {
             id = *it;
             str += to_string(m_out_val_map.find(id)->second);
         }
@@ -486,12 +935,15 @@ namespace gashgc {
     {
         m_gc = GC();
         m_c = Circuit();
+        m_fc.clear();
+        m_fgc.clear();
         m_in_val_map = IdValueMap();
         m_out_val_map = IdValueMap();
         m_self_in_id_set = IdSet();
         m_peer_in_id_set = IdSet();
         m_circ_fpath = string();
         m_input_fpath = string();
+        m_in_lbl_map = IdLabelMap();
         return 0;
     }
 
@@ -499,6 +951,10 @@ namespace gashgc {
     Evaluator::~Evaluator()
     {
 
+        delete m_pool;
+        delete m_ot_pool;
+        delete m_ot;
+
         shutdown(m_peer_sock, SHUT_WR);
         close(m_peer_sock);
 
@@ -21,9 +21,14 @@
 
 #include "../include/common.hh"
 #include "garbled_circuit.hh"
+#include "aes.hh"
+#include "pool.hh"
 
 namespace gashgc {
 
+  class OTParty;
+  class OTPool;
+
   class Evaluator {
   public:
 
@@ -33,6 +38,46 @@ namespace gashgc {
     /// The circuit instance
     Circuit               m_c;
 
+    /// Run on the flat circuit representation instead of m_c/m_gc
+    bool                  m_flat = true;
+
+    /// Garbling scheme of non-XOR gates, GC_GRR3 or GC_HALF_GATES (flat circuit only)
+    int                   m_scheme = GC_GRR3;
+
+    /// Stream the garbled tables in bulk, without per gate ids (flat circuit only).
+    /// Must match the peer, a peer on the Circuit path needs it off
+    bool                  m_bulk_egtt = true;
+
+    /// Receive the self input labels by correlated OT, see Garbler::m_cot.
+    /// Must match the peer, recv_self_lbls then comes before recv_egtt
+    bool                  m_cot = false;
+
+    /// Hold a single chunk of tables, set when recv_and_evaluate_circ is used
+    bool                  m_stream = false;
+
+    /// Threads evaluating the gates of a level (flat circuit only)
+    u32                   m_nthread = 1;
+
+    /// The flat circuit and its garbled state, used when m_flat is set
+    FlatCircuit           m_fc;
+    FlatGarbledCircuit    m_fgc;
+
+    /// Fixed-key AES used for every garbled row, round keys are expanded once
+    FixedKeyAES           m_aes;
+
+    /// Threads for m_nthread > 1, started on first use
+    WorkerPool*           m_pool = NULL;
+
+    /// OT session with the garbler, opened by the first recv_self_lbls and
+    /// reused by every later one
+    OTParty*              m_ot = NULL;
+
+    /// Threads of OT extension, must match the peer, set before the first OT
+    u32                   m_ot_nthread = 1;
+
+    /// Random OTs precomputed by start_ot_pool, NULL to run OT online
+    OTPool*               m_ot_pool = NULL;
+
     /// Number of inputs
     u32                   m_n_self_in;
     u32                   m_n_peer_in;
@@ -45,6 +90,10 @@ namespace gashgc {
     IdSet                 m_self_in_id_set;
     IdSet                 m_peer_in_id_set;
 
+    /// Input wires whose active label is given, from an earlier circuit, see
+    /// Garbler::m_in_lbl_map (flat circuit only)
+    IdLabelMap            m_in_lbl_map;
+
     /// Network related stuff
     int                   m_peer_sock;
     int                   m_peer_ot_sock;
@@ -91,6 +140,48 @@ namespace gashgc {
      */
     int evaluate_circ();
 
+    /**
+     * Evaluate the flat circuit, gates are visited in topological order
+     *
+     * @param stream Receive every chunk of tables when it is first needed
+     *
+     * @return 0 if succeeds, otherwise errno is returned
+     */
+    int evaluate_flat_circ(bool stream = false);
+
+    /**
+     * Evaluate flat gates g0 .. g1 - 1, all of one level. Safe to call from
+     * several threads on disjoint ranges
+     *
+     * @param g0
+     * @param g1
+     * @param tbl Rows of the first non-XOR gate
+     *
+     * @return Past the rows of the last non-XOR gate
+     */
+    const block* evaluate_flat_gates(u32 g0, u32 g1, const block* tbl);
+
+    /**
+     * Evaluate flat gates g0 .. g1 - 1, all of one level, on m_pool
+     *
+     * @param g0
+     * @param g1
+     * @param tbl
+     *
+     * @return Past the rows of the last non-XOR gate
+     */
+    const block* evaluate_flat_level(u32 g0, u32 g1, const block* tbl);
+
+    /**
+     * Streaming replacement for recv_egtt, recv_self_lbls, recv_peer_lbls and
+     * evaluate_circ (flat circuit only, needs m_stream set before
+     * build_garbled_circuit). Each chunk of tables is evaluated as it arrives
+     * from Garbler::garble_and_send_circ
+     *
+     * @return 0 if succeeds, otherwise errno is returned
+     */
+    int recv_and_evaluate_circ();
+
     /**
      * Initialize connections
      *
@@ -115,6 +206,36 @@ namespace gashgc {
      */
     int recv_self_lbls();
 
+    /**
+     * Start filling a pool of random OTs in the background, which
+     * recv_self_lbls then uses instead of running OT online. The garbler must
+     * call start_ot_pool with the same arguments
+     *
+     * @param n Random OTs to precompute, about the input bits expected
+     * @param batch Refill by this much when fewer than it are left, 0 for
+     * no refill beyond what each execution needs
+     *
+     * @return 0 if success, otherwise errno is returned
+     */
+    int start_ot_pool(u32 n, u32 batch);
+
+    /**
+     * The OT session, created on first use
+     *
+     * @return
+     */
+    OTParty* ot_party();
+
+    /**
+     * Receive the labels of the self input with random OTs from m_ot_pool,
+     * one round: send the choice corrections, receive both labels masked
+     *
+     * @param idlblmap
+     *
+     * @return 0 if success, otherwise errno is returned
+     */
+    int recv_self_lbls_pool(map<u32, block>& idlblmap);
+
     /**
      * Receive the labels corresponding to the peer's input
      *
@@ -19,6 +19,8 @@
 
 #include "garbled_circuit.hh"
 
+#include <mutex>
+
 #include "util.hh"
 
 namespace gashgc {
@@ -369,4 +371,105 @@ namespace gashgc {
         return 0;
     }
 
+    /**
+     * Flat Garbled Circuit
+     *
+     */
+
+    void FlatGarbledCircuit::init()
+    {
+        static std::once_flag seeded;
+        std::call_once(seeded, [] { srand_sse(time(NULL)); });
+        m_R = random_block();
+        set_lsb(m_R);
+    }
+
+    void FlatGarbledCircuit::alloc(FlatCircuit& circ, int scheme)
+    {
+        m_scheme = scheme;
+        m_nrow = scheme == GC_HALF_GATES ? 2 : 3;
+        m_lbl.resize(circ.m_nwire);
+        m_tbl.resize(m_nrow * (size_t)circ.m_nnonxor);
+    }
+
+    void FlatGarbledCircuit::alloc_stream(FlatCircuit& circ, int scheme)
+    {
+        m_scheme = scheme;
+        m_nrow = scheme == GC_HALF_GATES ? 2 : 3;
+        m_lbl.resize(circ.m_nwire);
+        LabelVec(m_nrow * (size_t)std::min(circ.m_nnonxor, (u32)EGTT_STREAM_CHUNK)).swap(m_tbl);
+    }
+
+    int FlatGarbledCircuit::get_lbl(FlatCircuit& circ, u32 id, int val, block& lbl)
+    {
+        GASSERT(val == 0 || val == 1);
+        u32 idx = circ.get_idx(id);
+        if (idx == FLAT_NO_WIRE) {
+            return -G_ENOENT;
+        }
+        lbl = val ? xor_block(m_lbl[idx], m_R) : m_lbl[idx];
+        return 0;
+    }
+
+    int FlatGarbledCircuit::get_orig_lbl(FlatCircuit& circ, u32 id, int val, block& lbl)
+    {
+        GASSERT(val == 0 || val == 1);
+        u32 idx = circ.get_idx(id);
+        if (idx == FLAT_NO_WIRE) {
+            return -G_ENOENT;
+        }
+        lbl = (val ^ circ.get_inv(idx)) ? xor_block(m_lbl[idx], m_R) : m_lbl[idx];
+        return 0;
+    }
+
+    int FlatGarbledCircuit::set_gwl(FlatCircuit& circ, u32 id, block lbl)
+    {
+        u32 idx = circ.get_idx(id);
+        if (idx == FLAT_NO_WIRE) {
+            return -G_ENOENT;
+        }
+        m_lbl[idx] = lbl;
+        return 0;
+    }
+
+    int FlatGarbledCircuit::add_out_lbls(FlatCircuit& circ, u32 id, block orig_lbl0, block orig_lbl1)
+    {
+        u32 idx = circ.get_idx(id);
+        if (idx == FLAT_NO_WIRE) {
+            return -G_ENOENT;
+        }
+        if (circ.get_inv(idx)) {
+            m_out_lbl_map[id] = make_pair(orig_lbl1, orig_lbl0);
+        } else {
+            m_out_lbl_map[id] = make_pair(orig_lbl0, orig_lbl1);
+        }
+        return 0;
+    }
+
+    int FlatGarbledCircuit::recover_smtc(FlatCircuit& circ, u32 id)
+    {
+        u32 idx = circ.get_idx(id);
+        auto it = m_out_lbl_map.find(id);
+        if (idx == FLAT_NO_WIRE || it == m_out_lbl_map.end()) {
+            WARNING("Cannot find output labels for wire id: " << id);
+            return -G_ENOENT;
+        }
+
+        if (block_eq(m_lbl[idx], it->second.first)) {
+            return 0;
+        } else if (block_eq(m_lbl[idx], it->second.second)) {
+            return 1;
+        }
+
+        WARNING("Invalid label, neither label0 nor label 1");
+        return -G_ENOENT;
+    }
+
+    void FlatGarbledCircuit::clear()
+    {
+        LabelVec().swap(m_lbl);
+        LabelVec().swap(m_tbl);
+        m_out_lbl_map.clear();
+    }
+
 } // namespace gashgc
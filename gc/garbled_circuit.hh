@@ -30,6 +30,16 @@
 #define GC     GarbledCircuit
 #define GG     GarbledGate
 
+/* Garbling schemes for non-XOR gates */
+#define GC_GRR3        0      // Garbled row reduction, 3 rows per gate
+#define GC_HALF_GATES  1      // Half gates, 2 rows per gate
+
+/// Non-XOR gates per table chunk when garbling and evaluating are streamed
+#define EGTT_STREAM_CHUNK (1 << 14)
+
+/// Gates per task when a level is split across threads
+#define FLAT_TASK_SZ 256
+
 namespace gashgc {
 
   class GarbledGate;
@@ -686,6 +696,121 @@ namespace gashgc {
     u32 marshal_size();
   };
 
+  /**
+   * Flat Garbled Circuit
+   *
+   * Garbled state for a FlatCircuit, indexed by dense wire index and by gate
+   * order instead of by id. The garbler keeps the label of semantic 0 of every
+   * wire (the label of semantic 1 is always that label xor R), the evaluator
+   * keeps the active label of every wire.
+   *
+   */
+  class FlatGarbledCircuit {
+  public:
+    block                      m_R;
+
+    /// Garbling scheme of the non-XOR gates and the rows each of them carries
+    int                        m_scheme = GC_GRR3;
+    u32                        m_nrow = 3;
+
+    /// Label of every wire, indexed by dense wire index
+    LabelVec                   m_lbl;
+
+    /// Rows of every non-XOR gate, m_nrow per gate, in gate order. For GRR3
+    /// these are rows 1-3 of the EGTT, for half gates the garbler half and
+    /// the evaluator half
+    LabelVec                   m_tbl;
+
+    /// Output wire id -> labels for semantic 0 and 1 (evaluator only)
+    map<u32, pair<block, block> > m_out_lbl_map;
+
+    /**
+     * Init R
+     *
+     */
+    void init();
+
+    /**
+     * Allocate the label and table storage for `circ`
+     *
+     * @param circ
+     * @param scheme GC_GRR3 or GC_HALF_GATES
+     */
+    void alloc(FlatCircuit& circ, int scheme);
+
+    /**
+     * Allocate the label storage for `circ` and a table for one chunk of
+     * EGTT_STREAM_CHUNK non-XOR gates
+     *
+     * @param circ
+     * @param scheme GC_GRR3 or GC_HALF_GATES
+     */
+    void alloc_stream(FlatCircuit& circ, int scheme);
+
+    /**
+     * Get label for wire with id `id` for semantic `val`
+     *
+     * @param circ
+     * @param id
+     * @param val
+     * @param lbl
+     *
+     * @return 0 if success, -G_ENOENT if wire does not exist
+     */
+    int get_lbl(FlatCircuit& circ, u32 id, int val, block& lbl);
+
+    /**
+     * Get the original (uninverted) label for wire with id `id` and semantic `val`
+     *
+     * @param circ
+     * @param id
+     * @param val
+     * @param lbl
+     *
+     * @return 0 if success, -G_ENOENT if wire does not exist
+     */
+    int get_orig_lbl(FlatCircuit& circ, u32 id, int val, block& lbl);
+
+    /**
+     * Set the active label of wire with id `id`
+     *
+     * @param circ
+     * @param id
+     * @param lbl
+     *
+     * @return 0 if success, -G_ENOENT if wire does not exist
+     */
+    int set_gwl(FlatCircuit& circ, u32 id, block lbl);
+
+    /**
+     * Record the output map entry of wire `id` from its original labels
+     *
+     * @param circ
+     * @param id
+     * @param orig_lbl0
+     * @param orig_lbl1
+     *
+     * @return 0 if success, -G_ENOENT if wire does not exist
+     */
+    int add_out_lbls(FlatCircuit& circ, u32 id, block orig_lbl0, block orig_lbl1);
+
+    /**
+     * Recover the semantic of output wire `id` from its active label
+     *
+     * @param circ
+     * @param id
+     *
+     * @return 0/1 if success, negative errno if failed
+     */
+    int recover_smtc(FlatCircuit& circ, u32 id);
+
+    /**
+     * Release all storage
+     *
+     */
+    void clear();
+  };
+
 }
 
 #endif
@@ -21,15 +21,36 @@
 
 #include "aes.hh"
 #include "ot.hh"
+#include "otpool.hh"
 #include "tcp.hh"
 #include "util.hh"
 
 namespace gashgc {
 
-    extern block AESkey;
-
     const static u32 xor_mnum = xor_magic_num;
     const static u32 nxor_mnum = nonxor_magic_num;
+    const static u32 hg_mnum = halfgate_magic_num;
+    const static u32 bulk_mnum = egtt_bulk_magic_num;
+
+/// Number of non-XOR gates garbled together, each takes 4 AES blocks
+#define GARBLE_BATCH_SZ (AES_BATCH_SZ / 2)
+
+    /**
+     * Send the header of a bulk table stream
+     *
+     * @param sock
+     * @param scheme
+     * @param nnonxor
+     *
+     * @return
+     */
+    static int send_bulk_hdr(int sock, int scheme, u32 nnonxor)
+    {
+        REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, (char*)&bulk_mnum, sizeof(u32)));
+        REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, (char*)(scheme == GC_HALF_GATES ? &hg_mnum : &nxor_mnum), sizeof(u32)));
+        REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, (char*)&nnonxor, sizeof(u32)));
+        return 0;
+    }
 
     Garbler::Garbler(string peer_ip, u16 port, u16 ot_port, string circ_file_path, string input_file_path)
     {
@@ -42,6 +63,14 @@ namespace gashgc {
 
     int Garbler::build_circ()
     {
+        if (m_flat) {
+            m_garbled = false;
+            return build_circuit(m_circ_fpath, m_fc);
+        }
+        if (m_scheme != GC_GRR3) {
+            WARNING("Half gates garbling requires the flat circuit");
+            return -G_EINVAL;
+        }
         return build_circuit(m_circ_fpath, m_c);
     }
 
@@ -58,6 +87,9 @@ namespace gashgc {
         u32 size;
         u32 id;
         int val;
+        u32 nin = m_flat ? m_fc.m_nin : m_c.m_nin;
+        IdSet& in_id_set = m_flat ? m_fc.m_in_id_set : m_c.m_in_id_set;
+
         while (getline(file, line)) {
 
             linum++;
@@ -72,7 +104,7 @@ namespace gashgc {
 
                 size = stoi(items[1]);
                 m_n_self_in = size;
-                m_n_peer_in = m_c.m_nin - size;
+                m_n_peer_in = nin - size;
 
                 continue;
             }
@@ -104,9 +136,10 @@ namespace gashgc {
 
         // Figure out peer's id set by adding every id that's in the input id set
         // but not in m_self_in_id_set
-        for (auto it = m_c.m_in_id_set.begin(); it != m_c.m_in_id_set.end(); ++it) {
+        for (auto it = in_id_set.begin(); it != in_id_set.end(); ++it) {
             id = *it;
-            if (m_self_in_id_set.find(id) == m_self_in_id_set.end()) {
+            if (m_self_in_id_set.find(id) == m_self_in_id_set.end() &&
+                m_in_lbl_map.find(id) == m_in_lbl_map.end()) {
                 m_peer_in_id_set.emplace(id);
             }
         }
@@ -145,6 +178,12 @@ namespace gashgc {
 
         block tweak;
 
+        const FixedKeyAES& aes = m_aes;
+
+        if (m_flat) {
+            return garble_flat_circ();
+        }
+
         m_gc.init();
 
 #ifdef GASH_DEBUG
@@ -256,8 +295,7 @@ namespace gashgc {
                 frst_row_smtc = eval_bgate(gin0->get_smtc_w_lsb(0), gin1->get_smtc_w_lsb(0), func);
 
                 // Encrypt the label
-                lbl = encrypt(gin0->get_lbl_w_lsb(0), gin1->get_lbl_w_lsb(0), tweak, ZERO,
-                    AESkey);
+                lbl = aes.encrypt(gin0->get_lbl_w_lsb(0), gin1->get_lbl_w_lsb(0), tweak, ZERO);
 
                 gout->set_lbl_w_smtc(lbl, frst_row_smtc);
                 gout->set_lbl_w_smtc(xor_block(lbl, m_gc.m_R), frst_row_smtc ^ 1);
@@ -299,29 +337,26 @@ namespace gashgc {
 #endif
 
                 // Write label to encrypted garbled truth table
-                gtt[1] = encrypt(gin0->get_lbl_w_lsb(1),
+                gtt[1] = aes.encrypt(gin0->get_lbl_w_lsb(1),
                     gin1->get_lbl_w_lsb(0),
                     tweak,
                     gout->get_lbl_w_smtc(eval_bgate(gin0->get_smtc_w_lsb(1),
                         gin1->get_smtc_w_lsb(0),
-                        func)),
-                    AESkey);
+                        func)));
 
-                gtt[2] = encrypt(gin0->get_lbl_w_lsb(0),
+                gtt[2] = aes.encrypt(gin0->get_lbl_w_lsb(0),
                     gin1->get_lbl_w_lsb(1),
                     tweak,
                     gout->get_lbl_w_smtc(eval_bgate(gin0->get_smtc_w_lsb(0),
                         gin1->get_smtc_w_lsb(1),
-                        func)),
-                    AESkey);
+                        func)));
 
-                gtt[3] = encrypt(gin0->get_lbl_w_lsb(1),
+                gtt[3] = aes.encrypt(gin0->get_lbl_w_lsb(1),
                     gin1->get_lbl_w_lsb(1),
                     tweak,
                     gout->get_lbl_w_smtc(eval_bgate(gin0->get_smtc_w_lsb(1),
                         gin1->get_smtc_w_lsb(1),
-                        func)),
-                    AESkey);
+                        func)));
 
 #ifdef GASH_DEBUG
 
@@ -365,6 +400,291 @@ namespace gashgc {
         return 0;
     }
 
+    int Garbler::garble_flat_circ(bool stream)
+    {
+
+        FlatCircuit& c = m_fc;
+        block* tbl;
+        block* tbl_end;
+        u32 g, g1, end;
+        u32 room;
+
+        if (!stream) {
+            draw_flat_lbls(false);
+        }
+        m_lbl_drawn = false;
+
+        if (m_nthread > 1 && (m_pool == NULL || m_pool->size() != m_nthread)) {
+            delete m_pool;
+            m_pool = new WorkerPool(m_nthread);
+        }
+
+        tbl = m_fgc.m_tbl.data();
+        tbl_end = tbl + m_fgc.m_tbl.size();
+
+        for (u32 l = 0; l < c.m_nlevel; l++) {
+
+            g = c.m_level_start[l];
+            end = c.m_level_start[l + 1];
+
+            if (!stream) {
+                if (m_nthread > 1 && end - g >= 2 * FLAT_TASK_SZ) {
+                    tbl = garble_flat_level(g, end, tbl);
+                } else {
+                    tbl = garble_flat_gates(g, end, tbl);
+                }
+                continue;
+            }
+
+            // Garble as many gates as the chunk has room for, send it when full
+            while (g < end) {
+
+                if (tbl == tbl_end && tbl_end != m_fgc.m_tbl.data()) {
+                    tbl = m_fgc.m_tbl.data();
+                    REQUIRE_GOOD_STATUS(tcp_send_bulk(m_peer_sock, (char*)tbl, m_fgc.m_tbl.size() * LABELSIZE));
+                }
+
+                room = (tbl_end - tbl) / m_fgc.m_nrow;
+                for (g1 = g; g1 < end && (room > 0 || c.m_func[g1] == funcXOR); g1++) {
+                    room -= c.m_func[g1] != funcXOR;
+                }
+
+                tbl = garble_flat_gates(g, g1, tbl);
+                g = g1;
+            }
+        }
+
+        if (stream && tbl != m_fgc.m_tbl.data()) {
+            REQUIRE_GOOD_STATUS(tcp_send_bulk(m_peer_sock, (char*)m_fgc.m_tbl.data(), (tbl - m_fgc.m_tbl.data()) * LABELSIZE));
+        }
+
+        m_garbled = true;
+        return 0;
+    }
+
+    block* Garbler::garble_flat_gates(u32 g0, u32 g1, block* tbl)
+    {
+
+        FlatCircuit& c = m_fc;
+        LabelVec& lbl = m_fgc.m_lbl;
+        const FixedKeyAES& aes = m_aes;
+        u32 nrow = m_fgc.m_nrow;
+        bool half = m_scheme == GC_HALF_GATES;
+
+        block R = m_fgc.m_R;
+        block ZERO = getZEROblock();
+        block tweak;
+        block a[2];
+        block b[2];
+        block out0;
+        block tg;
+        block te;
+
+        u32 in0, in1, out;
+        int func;
+        int va, vb;
+        int ia, ib;
+
+        // split[func] is {and-like, alpha, beta, gamma}, see split_bgate
+        int split[16][4];
+
+        // Non-XOR gates of one level are garbled GARBLE_BATCH_SZ at a time,
+        // all their rows go through the AES unit together
+        block ka[4 * GARBLE_BATCH_SZ];
+        block kb[4 * GARBLE_BATCH_SZ];
+        block kt[4 * GARBLE_BATCH_SZ];
+        block h[4 * GARBLE_BATCH_SZ];
+        int smtc[4 * GARBLE_BATCH_SZ];
+        u32 batch_out[GARBLE_BATCH_SZ];
+        block* batch_tbl[GARBLE_BATCH_SZ];
+        u32 nbatch = 0;
+
+        auto flush = [&]() {
+            aes.encrypt_n(ka, kb, kt, NULL, h, 4 * nbatch);
+            for (u32 i = 0; i < nbatch; i++) {
+
+                if (half) {
+                    // h holds H(A0), H(A1) in the a slot and H(B0), H(B1) in the b slot
+                    tg = xor_block(h[4 * i], h[4 * i + 1]);
+                    tg = get_lsb(kb[4 * i + 2]) ? xor_block(tg, R) : tg;
+                    te = xor_block(xor_block(h[4 * i + 2], h[4 * i + 3]), ka[4 * i]);
+
+                    // Label of 0 on the AND is the sum of the two half gates
+                    out0 = get_lsb(ka[4 * i]) ? xor_block(h[4 * i], tg) : h[4 * i];
+                    out0 = xor_block(out0, get_lsb(kb[4 * i + 2]) ? h[4 * i + 3] : h[4 * i + 2]);
+                    lbl[batch_out[i]] = smtc[4 * i] ? xor_block(out0, R) : out0;
+
+                    batch_tbl[i][0] = tg;
+                    batch_tbl[i][1] = te;
+                    continue;
+                }
+
+                // The first row is implicit (GRR), it fixes the output labels
+                out0 = smtc[4 * i] ? xor_block(h[4 * i], R) : h[4 * i];
+                lbl[batch_out[i]] = out0;
+                for (int r = 1; r < 4; r++) {
+                    batch_tbl[i][r - 1] = xor_block(h[4 * i + r], smtc[4 * i + r] ? xor_block(out0, R) : out0);
+                }
+            }
+            nbatch = 0;
+        };
+
+        for (func = 0; func < 16; func++) {
+            split[func][0] = split_bgate(func, split[func][1], split[func][2], split[func][3]);
+        }
+
+        for (u32 g = g0; g < g1; g++) {
+
+            in0 = c.m_in0[g];
+            in1 = c.m_in1[g];
+            out = c.m_out[g];
+            func = c.m_func[g];
+
+            if (func == funcXOR) {
+                lbl[out] = xor_block(lbl[in0], lbl[in1]);
+                continue;
+            }
+
+            tweak = new_tweak(c.m_wire_id[out]);
+
+            if (half) {
+                ia = c.get_inv(in0) ? 1 : 0;
+                ib = c.get_inv(in1) ? 1 : 0;
+
+                // Affine gates are free, their rows stay zero
+                if (!split[func][0]) {
+                    out0 = split[func][1] ? lbl[in0] : ZERO;
+                    out0 = split[func][2] ? xor_block(out0, lbl[in1]) : out0;
+                    lbl[out] = split[func][3] ^ (split[func][1] & ia) ^ (split[func][2] & ib) ? xor_block(out0, R) : out0;
+                    for (u32 r = 0; r < nrow; r++) {
+                        *tbl++ = ZERO;
+                    }
+                    continue;
+                }
+
+                // The gate is ((x ^ alpha) & (y ^ beta)) ^ gamma, a[0]/b[0] are
+                // the labels that make each side of the AND 0
+                a[0] = split[func][1] ^ ia ? xor_block(lbl[in0], R) : lbl[in0];
+                b[0] = split[func][2] ^ ib ? xor_block(lbl[in1], R) : lbl[in1];
+
+                ka[4 * nbatch] = a[0];
+                ka[4 * nbatch + 1] = xor_block(a[0], R);
+                ka[4 * nbatch + 2] = ZERO;
+                ka[4 * nbatch + 3] = ZERO;
+                kb[4 * nbatch] = ZERO;
+                kb[4 * nbatch + 1] = ZERO;
+                kb[4 * nbatch + 2] = b[0];
+                kb[4 * nbatch + 3] = xor_block(b[0], R);
+                for (int r = 0; r < 4; r++) {
+                    kt[4 * nbatch + r] = tweak;
+                }
+                smtc[4 * nbatch] = split[func][3];
+
+            } else {
+
+                // a[i]/b[i] are the input labels whose lsb is i, va/vb the value
+                // the gate sees on a[0]/b[0]
+                a[0] = get_lsb(lbl[in0]) ? xor_block(lbl[in0], R) : lbl[in0];
+                a[1] = xor_block(a[0], R);
+                b[0] = get_lsb(lbl[in1]) ? xor_block(lbl[in1], R) : lbl[in1];
+                b[1] = xor_block(b[0], R);
+                va = get_lsb(lbl[in0]) ^ (c.get_inv(in0) ? 1 : 0);
+                vb = get_lsb(lbl[in1]) ^ (c.get_inv(in1) ? 1 : 0);
+
+                for (int r = 0; r < 4; r++) {
+                    ka[4 * nbatch + r] = a[r & 1];
+                    kb[4 * nbatch + r] = b[r >> 1];
+                    kt[4 * nbatch + r] = tweak;
+                    smtc[4 * nbatch + r] = eval_bgate(va ^ (r & 1), vb ^ (r >> 1), func);
+                }
+            }
+
+            batch_out[nbatch] = out;
+            batch_tbl[nbatch] = tbl;
+            tbl += nrow;
+
+            if (++nbatch == GARBLE_BATCH_SZ) {
+                flush();
+            }
+        }
+
+        if (nbatch > 0) {
+            flush();
+        }
+
+        return tbl;
+    }
+
+    block* Garbler::garble_flat_level(u32 g0, u32 g1, block* tbl)
+    {
+
+        FlatCircuit& c = m_fc;
+        u32 ntask = (g1 - g0 + FLAT_TASK_SZ - 1) / FLAT_TASK_SZ;
+        vector<block*> task_tbl(ntask + 1);
+
+        // Every task writes its rows after those of the tasks before it
+        task_tbl[0] = tbl;
+        for (u32 t = 0; t < ntask; t++) {
+            u32 n = 0;
+            for (u32 g = g0 + t * FLAT_TASK_SZ; g < std::min(g1, g0 + (t + 1) * FLAT_TASK_SZ); g++) {
+                n += c.m_func[g] != funcXOR;
+            }
+            task_tbl[t + 1] = task_tbl[t] + n * m_fgc.m_nrow;
+        }
+
+        m_pool->run(ntask, [&](u32 t) {
+            garble_flat_gates(g0 + t * FLAT_TASK_SZ, std::min(g1, g0 + (t + 1) * FLAT_TASK_SZ), task_tbl[t]);
+        });
+
+        return task_tbl[ntask];
+    }
+
+    void Garbler::draw_flat_lbls(bool stream)
+    {
+
+        if (m_lbl_drawn) {
+            return;
+        }
+
+        if (!m_keep_R || !m_R_drawn) {
+            m_fgc.init();
+            m_R_drawn = true;
+        }
+        if (stream) {
+            m_fgc.alloc_stream(m_fc, m_scheme);
+        } else {
+            m_fgc.alloc(m_fc, m_scheme);
+        }
+
+        // Input labels are drawn in ascending id order, lbl holds the label of semantic 0
+        for (u32 idx : m_fc.m_in_idx) {
+            m_fgc.m_lbl[idx] = random_block();
+        }
+        for (auto it = m_in_lbl_map.begin(); it != m_in_lbl_map.end(); ++it) {
+            m_fgc.set_gwl(m_fc, it->first, it->second);
+        }
+
+        m_lbl_drawn = true;
+    }
+
+    int Garbler::garble_and_send_circ()
+    {
+
+        if (!m_flat) {
+            WARNING("Streaming garbling requires the flat circuit");
+            return -G_EINVAL;
+        }
+
+        draw_flat_lbls(true);
+
+        // The evaluator needs every input label before it can evaluate the first chunk
+        REQUIRE_GOOD_STATUS(send_peer_lbls());
+        REQUIRE_GOOD_STATUS(send_self_lbls());
+        REQUIRE_GOOD_STATUS(send_bulk_hdr(m_peer_sock, m_scheme, m_fc.m_nnonxor));
+
+        return garble_flat_circ(true);
+    }
+
     int Garbler::init_connection()
     {
 
@@ -381,6 +701,42 @@ namespace gashgc {
         block row2;
         block row3;
 
+        if (m_flat) {
+
+            block* tbl = m_fgc.m_tbl.data();
+
+            // Both parties hold the gates in the same order, so the rows of the
+            // non-XOR gates go out as one contiguous stream
+            if (m_bulk_egtt) {
+                REQUIRE_GOOD_STATUS(send_bulk_hdr(m_peer_sock, m_scheme, m_fc.m_nnonxor));
+                if (m_fgc.m_tbl.size() > 0) {
+                    REQUIRE_GOOD_STATUS(tcp_send_bulk(m_peer_sock, (char*)tbl, m_fgc.m_tbl.size() * LABELSIZE));
+                }
+                return 0;
+            }
+
+            size = m_fc.m_ngate;
+            REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
+
+            for (u32 g = 0; g < m_fc.m_ngate; g++) {
+
+                id = m_fc.m_wire_id[m_fc.m_out[g]];
+                REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&id, sizeof(u32)));
+
+                if (m_fc.m_func[g] == funcXOR) {
+                    REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&xor_mnum, sizeof(u32)));
+                    continue;
+                }
+
+                REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)(m_scheme == GC_HALF_GATES ? &hg_mnum : &nxor_mnum), sizeof(u32)));
+                for (u32 r = 0; r < m_fgc.m_nrow; r++) {
+                    REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)tbl++, LABELSIZE));
+                }
+            }
+
+            return 0;
+        }
+
         size = m_gc.m_gg_map.size();
         REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
 
@@ -434,7 +790,7 @@ namespace gashgc {
             val = val_it->second;
             GASSERT(val == 0 || val == 1);
 
-            REQUIRE_GOOD_STATUS(m_gc.get_lbl(id, val, lbl));
+            REQUIRE_GOOD_STATUS(m_flat ? m_fgc.get_lbl(m_fc, id, val, lbl) : m_gc.get_lbl(id, val, lbl));
 
             REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&id, sizeof(u32)));
             REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&lbl, LABELSIZE));
@@ -458,14 +814,23 @@ namespace gashgc {
         block lbl0;
         block lbl1;
 
+        // With m_cot this comes before garbling, see Garbler::m_cot
+        if (m_cot && m_flat) {
+            if (m_garbled) {
+                WARNING("With m_cot the peer labels must be sent before garbling");
+                return -G_EINVAL;
+            }
+            draw_flat_lbls(false);
+        }
+
         size = m_peer_in_id_set.size();
         REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
 
         for (auto it = m_peer_in_id_set.begin(); it != m_peer_in_id_set.end(); ++it) {
 
             id = *it;
-            REQUIRE_GOOD_STATUS(m_gc.get_lbl(id, 0, lbl0));
-            REQUIRE_GOOD_STATUS(m_gc.get_lbl(id, 1, lbl1));
+            REQUIRE_GOOD_STATUS(m_flat ? m_fgc.get_lbl(m_fc, id, 0, lbl0) : m_gc.get_lbl(id, 0, lbl0));
+            REQUIRE_GOOD_STATUS(m_flat ? m_fgc.get_lbl(m_fc, id, 1, lbl1) : m_gc.get_lbl(id, 1, lbl1));
 
             REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&id, sizeof(u32)));
             REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&lbl0, LABELSIZE));
@@ -475,6 +840,12 @@ namespace gashgc {
         return 0;
     }
 
+    int Garbler::start_ot_pool(u32 n, u32 batch)
+    {
+        // Labels go in the clear, there is nothing to precompute
+        return 0;
+    }
+
 #else
 
     int Garbler::send_peer_lbls()
@@ -487,23 +858,107 @@ namespace gashgc {
         LabelVec lbl0vec;
         LabelVec lbl1vec;
 
+        // With m_cot the OT fixes the labels, see Garbler::m_cot
+        if (m_cot && m_flat && !m_ot_pool && m_garbled) {
+            WARNING("With m_cot the peer labels must be sent before garbling");
+            return -G_EINVAL;
+        }
+
         size = m_peer_in_id_set.size();
         REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
 
+        // Every evaluator input may come as a label, see m_in_lbl_map
+        if (size == 0) {
+            return 0;
+        }
+
+        // With m_cot this comes before garbling, see Garbler::m_cot
+        if (m_cot && m_flat && !m_ot_pool) {
+            draw_flat_lbls(false);
+            return send_peer_lbls_cot();
+        }
+
         for (auto it = m_peer_in_id_set.begin(); it != m_peer_in_id_set.end(); ++it) {
 
             id = *it;
 
-            REQUIRE_GOOD_STATUS(m_gc.get_lbl(id, 0, lbl0));
-            REQUIRE_GOOD_STATUS(m_gc.get_lbl(id, 1, lbl1));
+            REQUIRE_GOOD_STATUS(m_flat ? m_fgc.get_lbl(m_fc, id, 0, lbl0) : m_gc.get_lbl(id, 0, lbl0));
+            REQUIRE_GOOD_STATUS(m_flat ? m_fgc.get_lbl(m_fc, id, 1, lbl1) : m_gc.get_lbl(id, 1, lbl1));
 
             lbl0vec.emplace_back(lbl0);
             lbl1vec.emplace_back(lbl1);
         }
 
-        // Call OTSend
-        OTParty otp;
-        REQUIRE_GOOD_STATUS(otp.OTSend(m_peer_ip, m_ot_port, lbl0vec, lbl1vec));
+        if (m_ot_pool) {
+            return send_peer_lbls_pool(lbl0vec, lbl1vec);
+        }
+
+        // Call OTSend, the base OTs only run on the first call
+        REQUIRE_GOOD_STATUS(ot_party()->OTSend(m_peer_ip, m_ot_port, lbl0vec, lbl1vec));
+
+        return 0;
+    }
+
+    int Garbler::send_peer_lbls_cot()
+    {
+
+        LabelVec lbl0vec;
+        u32 i;
+
+        REQUIRE_GOOD_STATUS(ot_party()->COTSend(m_peer_ip, m_ot_port, m_fgc.m_R, m_peer_in_id_set.size(), lbl0vec));
+
+        // The OT picked the label of 0, R is already the offset
+        i = 0;
+        for (auto it = m_peer_in_id_set.begin(); it != m_peer_in_id_set.end(); ++it, ++i) {
+            m_fgc.m_lbl[m_fc.get_idx(*it)] = lbl0vec[i];
+        }
+
+        return 0;
+    }
+
+    int Garbler::send_peer_lbls_pool(LabelVec& lbl0vec, LabelVec& lbl1vec)
+    {
+
+        u32 n = lbl0vec.size();
+        LabelVec m0;
+        LabelVec m1;
+        vector<u8> d(n);
+        vector<block> e(2 * n);
+
+        REQUIRE_GOOD_STATUS(m_ot_pool->take(n, m0, m1));
+
+        // d = b ^ c for every input, in id order
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)d.data(), n));
+
+        for (u32 i = 0; i < n; i++) {
+            e[2 * i] = _mm_xor_si128(lbl0vec[i], d[i] ? m1[i] : m0[i]);
+            e[2 * i + 1] = _mm_xor_si128(lbl1vec[i], d[i] ? m0[i] : m1[i]);
+        }
+
+        REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)e.data(), 2 * n * LABELSIZE));
+
+        return 0;
+    }
+
+    OTParty* Garbler::ot_party()
+    {
+
+        if (!m_ot) {
+            m_ot = new OTParty();
+            m_ot->m_nNumOTThreads = m_ot_nthread;
+        }
+
+        return m_ot;
+    }
+
+    int Garbler::start_ot_pool(u32 n, u32 batch)
+    {
+
+        delete m_ot_pool;
+        m_ot_pool = new OTPool(ot_party(), 0, m_peer_ip, m_ot_port);
+        m_ot_pool->m_low = batch;
+        m_ot_pool->m_batch = batch;
+        m_ot_pool->fill(n);
 
         return 0;
     }
@@ -520,6 +975,31 @@ namespace gashgc {
         block lbl1;
         WI* w;
 
+        if (m_flat) {
+
+            size = m_fc.m_out_id_set.size() - m_fc.m_out_const_map.size();
+            REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
+
+            for (auto it = m_fc.m_out_id_set.begin(); it != m_fc.m_out_id_set.end(); ++it) {
+
+                id = *it;
+
+                // Constant output
+                if (m_fc.m_out_const_map.find(id) != m_fc.m_out_const_map.end()) {
+                    continue;
+                }
+
+                REQUIRE_GOOD_STATUS(m_fgc.get_orig_lbl(m_fc, id, 0, lbl0));
+                REQUIRE_GOOD_STATUS(m_fgc.get_orig_lbl(m_fc, id, 1, lbl1));
+
+                REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&id, sizeof(u32)));
+                REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&lbl0, LABELSIZE));
+                REQUIRE_GOOD_STATUS(tcp_send_bytes(m_peer_sock, (char*)&lbl1, LABELSIZE));
+            }
+
+            return 0;
+        }
+
         size = m_c.m_out_id_set.size();
 
         for (auto it = m_c.m_out_id_set.begin(); it != m_c.m_out_id_set.end(); ++it) {
@@ -565,10 +1045,11 @@ namespace gashgc {
         u32 id;
         u32 size;
         int val;
+        IdSet& out_id_set = m_flat ? m_fc.m_out_id_set : m_c.m_out_id_set;
 
         REQUIRE_GOOD_STATUS(tcp_recv_bytes(m_peer_sock, (char*)&size, sizeof(u32)));
-        if (size != m_c.m_out_id_set.size()) {
-            WARNING("Output size inconsistent, expecting " << m_c.m_out_id_set.size() << ", getting " << size);
+        if (size != out_id_set.size()) {
+            WARNING("Output size inconsistent, expecting " << out_id_set.size() << ", getting " << size);
         }
 
 #ifdef GASH_DEBUG
@@ -599,7 +1080,9 @@ namespace gashgc {
     int Garbler::get_output(string& str)
     {
         u32 id;
-        for (auto it = m_c.m_out_id_vec.begin(); it != m_c.m_out_id_vec.end(); ++it) {
+        IdVec& out_id_vec = m_flat ? m_fc.m_out_id_vec : m_c.m_out_id_vec;
+
+        for (auto it = out_id_vec.begin(); it != out_id_vec.end(); ++it) {
             id = *it;
             str += to_string(m_out_val_map.find(id)->second);
         }
@@ -615,8 +1098,9 @@ namespace gashgc {
     {
 
         u32 id;
+        IdVec& out_id_vec = m_flat ? m_fc.m_out_id_vec : m_c.m_out_id_vec;
 
-        for (auto it = m_c.m_out_id_vec.begin(); it != m_c.m_out_id_vec.end(); ++it) {
+        for (auto it = out_id_vec.begin(); it != out_id_vec.end(); ++it) {
             id = *it;
             cout << id << ":" << m_out_val_map.find(id)->second << endl;
         }
@@ -629,18 +1113,27 @@ namespace gashgc {
     {
         m_gc = GC();
         m_c = Circuit();
+        m_fc.clear();
+        m_fgc.clear();
         m_in_val_map = IdValueMap();
         m_out_val_map = IdValueMap();
         m_self_in_id_set = IdSet();
         m_peer_in_id_set = IdSet();
         m_circ_fpath = string();
         m_input_fpath = string();
+        m_lbl_drawn = false;
+        m_garbled = false;
+        m_in_lbl_map = IdLabelMap();
         return 0;
     }
 
     Garbler::~Garbler()
     {
 
+        delete m_pool;
+        delete m_ot_pool;
+        delete m_ot;
+
         shutdown(m_listen_sock, SHUT_WR);
         close(m_listen_sock);
 
@@ -22,9 +22,14 @@
 
 #include "../include/common.hh"
 #include "garbled_circuit.hh"
+#include "aes.hh"
+#include "pool.hh"
 
 namespace gashgc {
 
+    class OTParty;
+    class OTPool;
+
     class Garbler {
     public:
         /// The garbled circuit instance
@@ -33,6 +38,65 @@ namespace gashgc {
         /// The circuit instance
         Circuit m_c;
 
+        /// Run on the flat circuit representation instead of m_c/m_gc
+        bool m_flat = true;
+
+        /// Garbling scheme of non-XOR gates, GC_GRR3 or GC_HALF_GATES (flat circuit only)
+        int m_scheme = GC_GRR3;
+
+        /// Stream the garbled tables in bulk, without per gate ids (flat circuit only).
+        /// Must match the peer, a peer on the Circuit path needs it off
+        bool m_bulk_egtt = true;
+
+        /// Send the evaluator's labels by correlated OT with offset R, one
+        /// message per OT instead of two (flat circuit only, ignored with an
+        /// OT pool). Must match the peer. The labels are then fixed by the OT,
+        /// so send_peer_lbls has to come before garble_circ, as the streamed
+        /// path already does, and returns -G_EINVAL otherwise. The evaluator
+        /// calls recv_self_lbls before recv_egtt
+        bool m_cot = false;
+
+        /// Threads garbling the gates of a level (flat circuit only). The tables
+        /// come out the same for any value
+        u32 m_nthread = 1;
+
+        /// The flat circuit and its garbled state, used when m_flat is set
+        FlatCircuit m_fc;
+        FlatGarbledCircuit m_fgc;
+
+        /// Fixed-key AES used for every garbled row, round keys are expanded once
+        FixedKeyAES m_aes;
+
+        /// Threads for m_nthread > 1, started on first use
+        WorkerPool* m_pool = NULL;
+
+        /// R and the input labels are drawn and not garbled yet
+        bool m_lbl_drawn = false;
+
+        /// The tables of the current circuit are garbled, its input labels
+        /// can no longer change
+        bool m_garbled = false;
+
+        /// Draw R once and keep it for every later garbling, so that labels
+        /// of one circuit stay valid as input labels of the next (flat
+        /// circuit only)
+        bool m_keep_R = false;
+        bool m_R_drawn = false;
+
+        /// Input wires whose label of 0 is given, from an earlier circuit
+        /// garbled with the same R. Neither party sends a label for them
+        IdLabelMap m_in_lbl_map;
+
+        /// OT session with the evaluator, opened by the first send_peer_lbls
+        /// and reused by every later one
+        OTParty* m_ot = NULL;
+
+        /// Threads of OT extension, must match the peer, set before the first OT
+        u32 m_ot_nthread = 1;
+
+        /// Random OTs precomputed by start_ot_pool, NULL to run OT online
+        OTPool* m_ot_pool = NULL;
+
         /// Number of inputs
         u32 m_n_self_in;
         u32 m_n_peer_in;
@@ -81,6 +145,50 @@ namespace gashgc {
      */
         int garble_circ();
 
+        /**
+     * Garble the flat circuit, gates are visited in topological order
+     *
+     * @param stream Send every chunk of tables as soon as it is garbled, m_fgc
+     *        must have been set up by garble_and_send_circ
+     *
+     * @return
+     */
+        int garble_flat_circ(bool stream = false);
+
+        /**
+     * Garble flat gates g0 .. g1 - 1, all of one level. Safe to call from
+     * several threads on disjoint ranges
+     *
+     * @param g0
+     * @param g1
+     * @param tbl Where the rows of the first non-XOR gate go
+     *
+     * @return Past the rows of the last non-XOR gate
+     */
+        block* garble_flat_gates(u32 g0, u32 g1, block* tbl);
+
+        /**
+     * Garble flat gates g0 .. g1 - 1, all of one level, on m_pool
+     *
+     * @param g0
+     * @param g1
+     * @param tbl
+     *
+     * @return Past the rows of the last non-XOR gate
+     */
+        block* garble_flat_level(u32 g0, u32 g1, block* tbl);
+
+        /**
+     * Streaming replacement for garble_circ, send_egtt, send_peer_lbls and
+     * send_self_lbls (flat circuit only). The input labels are sent first, then
+     * the tables go out chunk by chunk while the rest of the circuit is garbled,
+     * so only one chunk of tables is ever held. Call after init_connection, the
+     * evaluator calls recv_and_evaluate_circ
+     *
+     * @return 0 if success, otherwise errno is returned
+     */
+        int garble_and_send_circ();
+
         /**
      * Build connection with evaluator
      *
@@ -111,6 +219,54 @@ namespace gashgc {
      */
         int send_peer_lbls();
 
+        /**
+     * Draw R and the input labels of the flat circuit, unless they are drawn
+     * already for this garbling
+     *
+     * @param stream Allocate for streamed garbling
+     */
+        void draw_flat_lbls(bool stream);
+
+        /**
+     * Send evaluator's labels by correlated OT, R and the input labels must
+     * be drawn and not garbled yet. The evaluator's labels of 0 are replaced
+     * by the ones the OT picks
+     *
+     * @return
+     */
+        int send_peer_lbls_cot();
+
+        /**
+     * Send evaluator's labels with random OTs from m_ot_pool, one round:
+     * receive the choice corrections, send both labels masked
+     *
+     * @param lbl0vec Label of 0 of each evaluator input, in id order
+     * @param lbl1vec Label of 1
+     *
+     * @return
+     */
+        int send_peer_lbls_pool(vector<block>& lbl0vec, vector<block>& lbl1vec);
+
+        /**
+     * Start filling a pool of random OTs in the background, which
+     * send_peer_lbls then uses instead of running OT online. The evaluator
+     * must call start_ot_pool with the same arguments
+     *
+     * @param n Random OTs to precompute, about the input bits expected
+     * @param batch Refill by this much when fewer than it are left, 0 for
+     * no refill beyond what each execution needs
+     *
+     * @return 0 if success, otherwise errno is returned
+     */
+        int start_ot_pool(u32 n, u32 batch);
+
+        /**
+     * The OT session, created on first use
+     *
+     * @return
+     */
+        OTParty* ot_party();
+
         /**
      * Send output map to evaluator
      *
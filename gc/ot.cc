@@ -298,26 +298,12 @@ namespace gashgc {
         return success;
     }
 
-    int OTParty::OTSend(string peer_addr, int peer_ot_port, vector<block>& label0s,
-        vector<block>& label1s)
+    int OTParty::Open(string peer_addr, int peer_ot_port, u32 pid)
     {
 
-        GASSERT(label0s.size() == label1s.size());
-
-        uint32_t m_nLabel = label0s.size();
-        uint64_t numOTs = m_nLabel;
-
-        uint32_t bitlength = LABELSIZE * 8;
-        uint32_t nsndvals = 2;
-
-        m_eFType = ECC_FIELD;
-
         uint32_t m_nSecParam = 128;
 
-        m_nNumOTThreads = 1;
-
-        snd_ot_flavor stype = Snd_OT;
-        rec_ot_flavor rtype = Rec_OT;
+        m_eFType = ECC_FIELD;
 
         // The following two integers are only useful for ALSZ
         m_nBaseOTs = 190;
@@ -327,168 +313,307 @@ namespace gashgc {
 
         m_eProt = IKNP;
 
-        m_nAddr = peer_addr.c_str();
-        m_nPort = peer_ot_port;
-        m_nPID = 0;
+        // m_nAddr points into m_sAddr, which outlives the session
+        m_sAddr = peer_addr;
+        m_nPID = pid;
+
+        m_crypt = new crypto(m_nSecParam, (uint8_t*)m_cConstSeed[m_nPID]);
+        m_glock = new CLock();
+
+        if (m_nPID == 0) {
+            REQUIRE_GOOD_STATUS(InitOTSender(m_sAddr.c_str(), peer_ot_port, m_crypt, m_glock));
+        } else {
+            REQUIRE_GOOD_STATUS(InitOTReceiver(m_sAddr.c_str(), peer_ot_port, m_crypt, m_glock));
+        }
+
+        m_bOpen = true;
 
-        crypto* crypt = new crypto(m_nSecParam, (uint8_t*)m_cConstSeed[m_nPID]);
+        return 0;
+    }
+
+    void OTParty::Close()
+    {
 
-        CLock* glock = new CLock();
+        if (!m_bOpen) {
+            return;
+        }
 
-        REQUIRE_GOOD_STATUS(InitOTSender(peer_addr.c_str(), peer_ot_port, crypt, glock));
+        delete m_sender;
+        delete m_receiver;
+        m_sender = NULL;
+        m_receiver = NULL;
 
-        // TODO: if we don't need delta, delete it
-        CBitVector delta; // The R
+        Cleanup();
+        m_sndthread = NULL;
+        m_rcvthread = NULL;
+        m_vSocket = NULL;
 
-        CBitVector** X = (CBitVector**)malloc(sizeof(CBitVector*) * nsndvals);
+        delete m_crypt;
+        delete m_glock;
+        m_crypt = NULL;
+        m_glock = NULL;
 
-        m_fMaskFct = new XORMasking(bitlength, delta);
+        m_bOpen = false;
+    }
+
+    int OTParty::EnsureOpen(string peer_addr, int peer_ot_port, u32 pid)
+    {
+
+        if (m_bOpen && (m_nPID != pid || m_sAddr != peer_addr || m_nPort != peer_ot_port)) {
+            Close();
+        }
+        if (!m_bOpen) {
+            REQUIRE_GOOD_STATUS(Open(peer_addr, peer_ot_port, pid));
+        }
+
+        return 0;
+    }
 
-        delta.Create(numOTs, bitlength);
+    int OTParty::OTSend(string peer_addr, int peer_ot_port, vector<block>& label0s,
+        vector<block>& label1s)
+    {
 
-        BYTE** bytes = (BYTE**)malloc(sizeof(BYTE*) * nsndvals);
+        GASSERT(label0s.size() == label1s.size());
 
-        // for (u32 i = 0; i < nsndvals; i++) {
-        //   X[i] = new CBitVector();
-        //   X[i]->Create(numOTs, bitlength);
-        // }
+        u32 n = label0s.size();
 
-        // ObliviousSend(X, numOTs, bitlength, nsndvals, stype, rtype, crypt);
+        REQUIRE_GOOD_STATUS(EnsureOpen(peer_addr, peer_ot_port, 0));
 
-        for (int i = 0; i < nsndvals; ++i) {
+        cout << "Sending " << n << " labels" << endl;
 
-            X[i] = new CBitVector();
-            X[i]->Create(numOTs, bitlength);
+        for (u32 off = 0; off < n; off += OT_CHUNK) {
+            REQUIRE_GOOD_STATUS(SendChunk((const BYTE*)(label0s.data() + off),
+                                          (const BYTE*)(label1s.data() + off),
+                                          std::min(n - off, (u32)OT_CHUNK), LABELSIZE));
+        }
 
-            int size = m_nLabel * LABELSIZE;
-            bytes[i] = new BYTE[size];
-            memset(bytes[i], 0, size);
+        return 0;
+    }
+
+    int OTParty::OTRecv(string peer_addr, int peer_ot_port, map<u32, int>& selects,
+        map<u32, block>& res_idlbl_map)
+    {
+
+        vector<u8> sel;
+        vector<u32> ids;
+
+        // We are taking advantage of the fact that `selects` is ordered
+        for (auto it = selects.begin(); it != selects.end(); ++it) {
+            ids.emplace_back(it->first);
+            sel.emplace_back(it->second);
+        }
 
-            if (i == 0) {
-                REQUIRE_GOOD_STATUS(label_vec_marshal(label0s, (char*)bytes[i]));
-            } else {
-                REQUIRE_GOOD_STATUS(label_vec_marshal(label1s, (char*)bytes[i]));
+        return OTRecv(peer_addr, peer_ot_port, sel, [&](u32 off, const block* lbls, u32 n) {
+            for (u32 i = 0; i < n; ++i) {
+                res_idlbl_map.emplace(ids[off + i], lbls[i]);
             }
+        });
+    }
+
+    int OTParty::OTRecv(string peer_addr, int peer_ot_port, const vector<u8>& selects,
+        const LabelSink& sink)
+    {
+
+        u32 n = selects.size();
+
+        REQUIRE_GOOD_STATUS(EnsureOpen(peer_addr, peer_ot_port, 1));
+
+        cout << "Receiving " << n << " labels" << endl;
 
-            X[i]->SetBytes(bytes[i], 0, size);
+        vector<block> lbls(std::min(n, (u32)OT_CHUNK));
+        for (u32 off = 0; off < n; off += OT_CHUNK) {
+            u32 cnt = std::min(n - off, (u32)OT_CHUNK);
+            REQUIRE_GOOD_STATUS(RecvChunk(Snd_OT, selects.data() + off, cnt, LABELSIZE,
+                                          (BYTE*)lbls.data()));
+            sink(off, lbls.data(), cnt);
         }
 
-        cout << "Sending " << label0s.size() << " labels" << endl;
+        return 0;
+    }
 
-        ObliviousSend(X, numOTs, bitlength, nsndvals, stype, rtype, crypt);
+    int OTParty::OTSend64(string peer_addr, int peer_ot_port, const vector<u64>& msg0s,
+        const vector<u64>& msg1s)
+    {
 
-        cout << "------ OT sender ------" << endl;
-        cout << "Send amount: " << m_vSocket->getSndCnt() << endl;
-        cout << "Recv amount: " << m_vSocket->getRcvCnt() << endl;
+        GASSERT(msg0s.size() == msg1s.size());
 
-        Cleanup();
-        delete crypt;
-        delete glock;
+        u32 n = msg0s.size();
 
-        for (int i = 0; i < nsndvals; ++i) {
-            delete[] bytes[i];
+        REQUIRE_GOOD_STATUS(EnsureOpen(peer_addr, peer_ot_port, 0));
+
+        for (u32 off = 0; off < n; off += OT_CHUNK) {
+            REQUIRE_GOOD_STATUS(SendChunk((const BYTE*)(msg0s.data() + off),
+                                          (const BYTE*)(msg1s.data() + off),
+                                          std::min(n - off, (u32)OT_CHUNK), sizeof(u64)));
         }
 
-        free(bytes);
+        return 0;
+    }
+
+    int OTParty::OTRecv64(string peer_addr, int peer_ot_port, const vector<u8>& selects,
+        const U64Sink& sink)
+    {
+
+        u32 n = selects.size();
+
+        REQUIRE_GOOD_STATUS(EnsureOpen(peer_addr, peer_ot_port, 1));
+
+        vector<u64> msgs(std::min(n, (u32)OT_CHUNK));
+        for (u32 off = 0; off < n; off += OT_CHUNK) {
+            u32 cnt = std::min(n - off, (u32)OT_CHUNK);
+            REQUIRE_GOOD_STATUS(RecvChunk(Snd_OT, selects.data() + off, cnt, sizeof(u64),
+                                          (BYTE*)msgs.data()));
+            sink(off, msgs.data(), cnt);
+        }
 
         return 0;
     }
 
-    int OTParty::OTRecv(string peer_addr, int peer_ot_port, map<u32, int>& selects,
-        map<u32, block>& res_idlbl_map)
+    int OTParty::COTSend(string peer_addr, int peer_ot_port, block R, u32 n,
+        vector<block>& label0s)
     {
 
-        uint64_t numOTs = selects.size();
+        REQUIRE_GOOD_STATUS(EnsureOpen(peer_addr, peer_ot_port, 0));
 
-        uint32_t bitlength = LABELSIZE * 8;
-        uint32_t nsndvals = 2;
+        cout << "Sending " << n << " correlated labels" << endl;
 
-        m_eFType = ECC_FIELD;
+        label0s.resize(n);
+        for (u32 off = 0; off < n; off += OT_CHUNK) {
+            REQUIRE_GOOD_STATUS(COTSendChunk(R, label0s.data() + off, std::min(n - off, (u32)OT_CHUNK)));
+        }
 
-        uint32_t m_nSecParam = 128;
+        return 0;
+    }
 
-        m_nNumOTThreads = 1;
+    int OTParty::COTRecv(string peer_addr, int peer_ot_port, map<u32, int>& selects,
+        map<u32, block>& res_idlbl_map)
+    {
 
-        snd_ot_flavor stype = Snd_OT;
-        rec_ot_flavor rtype = Rec_OT;
+        vector<u8> sel;
+        vector<u32> ids;
 
-        // The following two integers are only useful for ALSZ
-        m_nBaseOTs = 190;
-        m_nChecks = 380;
+        for (auto it = selects.begin(); it != selects.end(); ++it) {
+            ids.emplace_back(it->first);
+            sel.emplace_back(it->second);
+        }
 
-        m_bUseMinEntCorAssumption = false;
+        return COTRecv(peer_addr, peer_ot_port, sel, [&](u32 off, const block* lbls, u32 n) {
+            for (u32 i = 0; i < n; ++i) {
+                res_idlbl_map.emplace(ids[off + i], lbls[i]);
+            }
+        });
+    }
 
-        m_eProt = IKNP;
+    int OTParty::COTRecv(string peer_addr, int peer_ot_port, const vector<u8>& selects,
+        const LabelSink& sink)
+    {
 
-        m_nAddr = peer_addr.c_str();
-        m_nPort = peer_ot_port;
-        m_nPID = 1;
+        u32 n = selects.size();
 
-        crypto* crypt = new crypto(m_nSecParam, (uint8_t*)m_cConstSeed[m_nPID]);
+        REQUIRE_GOOD_STATUS(EnsureOpen(peer_addr, peer_ot_port, 1));
 
-        CLock* glock = new CLock();
+        cout << "Receiving " << n << " correlated labels" << endl;
 
-        InitOTReceiver(peer_addr.c_str(), peer_ot_port, crypt, glock);
+        vector<block> lbls(std::min(n, (u32)OT_CHUNK));
+        for (u32 off = 0; off < n; off += OT_CHUNK) {
+            u32 cnt = std::min(n - off, (u32)OT_CHUNK);
+            REQUIRE_GOOD_STATUS(RecvChunk(Snd_C_OT, selects.data() + off, cnt, LABELSIZE,
+                                          (BYTE*)lbls.data()));
+            sink(off, lbls.data(), cnt);
+        }
 
-        CBitVector choices, response;
+        return 0;
+    }
 
+    int OTParty::SendChunk(const BYTE* msg0s, const BYTE* msg1s, u32 n, u32 bytes)
+    {
+
+        uint32_t bitlength = bytes * 8;
+        CBitVector X0, X1;
+        CBitVector* X[2] = { &X0, &X1 };
+
+        // Independent pairs, the correlated case is COTSendChunk
         m_fMaskFct = new XORMasking(bitlength);
 
-        vector<int> selects_vec;
+        X0.Create(n, bitlength);
+        X1.Create(n, bitlength);
+        X0.SetBytes((BYTE*)msg0s, 0, n * bytes);
+        X1.SetBytes((BYTE*)msg1s, 0, n * bytes);
 
-        // We are taking advantage of the fact that `selects` is ordered
-        for (auto it = selects.begin(); it != selects.end(); ++it) {
+        bool success = ObliviousSend(X, n, bitlength, 2, Snd_OT, Rec_OT, m_crypt);
+
+        delete m_fMaskFct;
 
-            selects_vec.push_back(it->second);
+        if (!success) {
+            WARNING("OT extension failed");
+            return -G_ETCP;
         }
 
-        // 1 bit per selection, there might be some empty bits at the last byte
-        u32 size = (u32)ceil(((float)selects_vec.size()) / 8.f);
-        cout << "Receiving using " << size << " bytes" << endl;
+        return 0;
+    }
 
-        // Alloc and initialize choice_bytes
-        BYTE choice_bytes[size];
-        memset(choice_bytes, 0, size);
-        REQUIRE_GOOD_STATUS(select2bytes(selects_vec, (char*)choice_bytes));
+    int OTParty::COTSendChunk(block R, block* label0s, u32 n)
+    {
 
-        // Change size back to the number of effective bits in the byte array
-        size = selects_vec.size();
+        uint32_t bitlength = LABELSIZE * 8;
+        CBitVector delta;
+        CBitVector X0, X1;
+        CBitVector* X[2] = { &X0, &X1 };
+
+        // Every OT has the same offset, the free-XOR R
+        delta.Create(n, bitlength);
+        for (u32 i = 0; i < n; ++i) {
+            delta.SetBytes((BYTE*)&R, i * LABELSIZE, LABELSIZE);
+        }
 
-        cout << "Receving using " << size << " selection bits" << endl;
+        m_fMaskFct = new XORMasking(bitlength, delta);
 
-        // Use the SetBits to precisely setting the bits
-        choices.Create(size, crypt);
-        choices.SetBits(choice_bytes, 0, size);
+        // X[0] comes back random, X[1] = X[0] ^ R
+        X0.Create(n, bitlength);
+        X1.Create(n, bitlength);
 
-        // Pre-generate the respose vector for the results
-        response.Create(numOTs, bitlength);
+        bool success = ObliviousSend(X, n, bitlength, 2, Snd_C_OT, Rec_OT, m_crypt);
 
-        response.Reset();
+        X0.GetBytes((BYTE*)label0s, 0, n * LABELSIZE);
 
-        ObliviousReceive(&choices, &response, numOTs, bitlength, nsndvals, stype,
-            rtype, crypt);
+        delete m_fMaskFct;
 
-        BYTE* response_bytes = new BYTE[selects.size() * LABELSIZE];
-        response.GetBytes(response_bytes, 0, selects.size() * LABELSIZE);
+        if (!success) {
+            WARNING("C-OT extension failed");
+            return -G_ETCP;
+        }
 
-        int i = 0;
+        return 0;
+    }
 
-        for (auto it = selects.begin(); it != selects.end(); ++it, ++i) {
+    int OTParty::RecvChunk(snd_ot_flavor stype, const u8* selects, u32 n, u32 bytes, BYTE* out)
+    {
 
-            u32 id = it->first;
-            block label;
+        uint32_t bitlength = bytes * 8;
+        CBitVector choices, response;
+
+        m_fMaskFct = new XORMasking(bitlength);
 
-            REQUIRE_GOOD_STATUS(byte2label((char*)response_bytes, LABELSIZE * i, label));
-            res_idlbl_map.emplace(id, label);
+        // On the heap, a few million choice bits do not fit on the stack
+        choices.Create(n);
+        for (u32 i = 0; i < n; ++i) {
+            choices.SetBit(i, selects[i]);
         }
 
-        cout << "------ OT receiver ------" << endl;
-        cout << "Send amount: " << m_vSocket->getSndCnt() << endl;
-        cout << "Recv amount: " << m_vSocket->getRcvCnt() << endl;
+        response.Create(n, bitlength);
+        response.Reset();
 
-        Cleanup();
-        delete crypt;
-        delete glock;
+        bool success = ObliviousReceive(&choices, &response, n, bitlength, 2, stype,
+            Rec_OT, m_crypt);
+
+        delete m_fMaskFct;
+
+        if (!success) {
+            WARNING("OT extension failed");
+            return -G_ETCP;
+        }
+
+        response.GetBytes(out, 0, n * bytes);
 
         return 0;
     }
@@ -20,6 +20,8 @@
 #ifndef GASH_OT_H
 #define GASH_OT_H
 
+#include <functional>
+
 #include "../include/common.hh"
 #include "OTExtension/ENCRYPTO_utils/cbitvector.h"
 #include "OTExtension/ENCRYPTO_utils/channel.h"
@@ -41,32 +43,90 @@
 #include "OTExtension/ot/xormasking.h"
 #include "util.hh"
 
+/// OTs per extension call, bounds the memory of one call for millions of inputs
+#define OT_CHUNK (1 << 20)
+
 namespace gashgc {
 
     typedef vector<block> LabelVec;
 
+    /// Takes received labels off + 0 .. off + n - 1, in the order of the choices
+    typedef std::function<void(u32 off, const block* lbls, u32 n)> LabelSink;
+
+    /// Takes received 64-bit messages off + 0 .. off + n - 1, as LabelSink
+    typedef std::function<void(u32 off, const u64* msgs, u32 n)> U64Sink;
+
+    /**
+     * OT extension party
+     *
+     * The first OTSend/OTRecv opens a session: it connects to the peer and
+     * runs the base OTs. Later calls run only the extension over the same
+     * channel, until Close() or the party is destroyed. Garbler and Evaluator
+     * keep one party for their whole lifetime.
+     *
+     */
     class OTParty {
     public:
         USHORT m_nPort;
         const char* m_nAddr;
-        CSocket* m_vSocket;
+        CSocket* m_vSocket = NULL;
         u32 m_nPID;
         field_type m_eFType;
         u32 m_nBitLength;
         MaskingFunction* m_fMaskFct;
         const char* m_cConstSeed[2] = { "437398417012387813714564100", "15657566154164561" };
 
-        OTExtSnd* m_sender;
-        OTExtRec* m_receiver;
-        SndThread* m_sndthread;
-        RcvThread* m_rcvthread;
-        u32 m_nNumOTThreads;
+        OTExtSnd* m_sender = NULL;
+        OTExtRec* m_receiver = NULL;
+        SndThread* m_sndthread = NULL;
+        RcvThread* m_rcvthread = NULL;
+        /// Threads OT extension runs on, set before the first call
+        u32 m_nNumOTThreads = 1;
         u32 m_nBaseOTs;
         u32 m_nChecks;
         bool m_bUseMinEntCorAssumption;
         ot_ext_prot m_eProt;
         double m_rndgentime;
 
+        /// Session state, kept between OTSend/OTRecv calls
+        bool m_bOpen = false;
+        string m_sAddr;
+        crypto* m_crypt = NULL;
+        CLock* m_glock = NULL;
+
+        ~OTParty()
+        {
+            Close();
+        }
+
+        /**
+         * Connect to the peer and run the base OTs, called once per session
+         *
+         * @param peer_addr
+         * @param peer_ot_port
+         * @param pid 0 for the sender, 1 for the receiver
+         *
+         * @return 0 if success, negative errno if failure
+         */
+        int Open(string peer_addr, int peer_ot_port, u32 pid);
+
+        /**
+         * Tear the session down, the next OTSend/OTRecv opens a new one
+         *
+         */
+        void Close();
+
+        /**
+         * Open the session unless one with the same peer and role is open
+         *
+         * @param peer_addr
+         * @param peer_ot_port
+         * @param pid
+         *
+         * @return 0 if success, negative errno if failure
+         */
+        int EnsureOpen(string peer_addr, int peer_ot_port, u32 pid);
+
         /**
         * Init the socket
         *
@@ -190,6 +250,95 @@ namespace gashgc {
         int OTRecv(string peer_addr, int peer_ot_port, map<u32, int>& selects,
                    map<u32, block>& res_idlbl_map);
 
+        /**
+         * Receive one label per choice bit, in OT_CHUNK pieces handed to
+         * `sink` as they arrive
+         *
+         * @param peer_addr
+         * @param peer_ot_port
+         * @param selects Choice bits, 0 or 1
+         * @param sink
+         *
+         * @return 0 if success, negative errno if failure
+         */
+        int OTRecv(string peer_addr, int peer_ot_port, const vector<u8>& selects,
+                   const LabelSink& sink);
+
+        /**
+         * OT of 64-bit messages, e.g. ring elements. The extension runs with
+         * a 64-bit message length, so each OT sends half the masked bytes of
+         * a label
+         *
+         * @param peer_addr
+         * @param peer_ot_port
+         * @param msg0s
+         * @param msg1s
+         *
+         * @return 0 if success, negative errno if failure
+         */
+        int OTSend64(string peer_addr, int peer_ot_port, const vector<u64>& msg0s,
+                     const vector<u64>& msg1s);
+
+        /**
+         * Receive the counterpart of OTSend64, in OT_CHUNK pieces handed to
+         * `sink` as they arrive
+         *
+         * @param peer_addr
+         * @param peer_ot_port
+         * @param selects Choice bits, 0 or 1
+         * @param sink
+         *
+         * @return 0 if success, negative errno if failure
+         */
+        int OTRecv64(string peer_addr, int peer_ot_port, const vector<u8>& selects,
+                     const U64Sink& sink);
+
+        /**
+         * Correlated OT send: the pairs are (L0, L0 ^ R) with one R for all
+         * of them, so a single masked message goes out per OT. The L0 are
+         * picked by the OT and returned
+         *
+         * @param peer_addr
+         * @param peer_ot_port
+         * @param R The free-XOR offset
+         * @param n Number of OTs
+         * @param label0s L0 of each OT
+         *
+         * @return 0 if success, negative errno if failure
+         */
+        int COTSend(string peer_addr, int peer_ot_port, block R, u32 n,
+                    vector<block>& label0s);
+
+        /**
+         * Correlated OT receive, the counterpart of COTSend
+         *
+         * @param peer_addr
+         * @param peer_ot_port
+         * @param selects Wire id to choice bit
+         * @param res_idlbl_map Wire id to L0 ^ choice * R
+         *
+         * @return 0 if success, negative errno if failure
+         */
+        int COTRecv(string peer_addr, int peer_ot_port, map<u32, int>& selects,
+                    map<u32, block>& res_idlbl_map);
+
+        /**
+         * Correlated OT receive into a sink, see OTRecv
+         *
+         */
+        int COTRecv(string peer_addr, int peer_ot_port, const vector<u8>& selects,
+                    const LabelSink& sink);
+
+    private:
+
+        /**
+         * One extension call of each kind, n <= OT_CHUNK. Send and receive
+         * take messages of `bytes` bytes each
+         *
+         */
+        int SendChunk(const BYTE* msg0s, const BYTE* msg1s, u32 n, u32 bytes);
+        int COTSendChunk(block R, block* label0s, u32 n);
+        int RecvChunk(snd_ot_flavor stype, const u8* selects, u32 n, u32 bytes, BYTE* out);
     };
 
 } // namespace gashgc
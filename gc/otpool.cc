@@ -0,0 +1,213 @@
+/*
+ * otpool.cc -- Pool of random OTs precomputed ahead of the online phase
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "otpool.hh"
+#include "util.hh"
+
+namespace gashgc {
+
+    OTPool::OTPool(OTParty* ot, u32 pid, string peer_ip, u16 port)
+        : m_ot(ot), m_pid(pid), m_peer_ip(peer_ip), m_port(port)
+    {
+        m_filler = std::thread(&OTPool::run, this);
+    }
+
+    OTPool::~OTPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_filler.join();
+    }
+
+    void OTPool::fill(u32 n)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        fill_locked(n);
+    }
+
+    void OTPool::fill_locked(u32 n)
+    {
+        Batch b;
+        block r;
+
+        if (n == 0) {
+            return;
+        }
+
+        // Drawn here, random_block is not safe to call from the filler
+        if (m_pid == 0) {
+            for (u32 i = 0; i < n; i++) {
+                b.m_m0.emplace_back(random_block());
+                b.m_m1.emplace_back(random_block());
+            }
+        } else {
+            for (u32 i = 0; i < n; i += 64) {
+                r = random_block();
+                u64 bits = _mm_cvtsi128_si64(r);
+                for (u32 j = 0; j < 64 && i + j < n; j++) {
+                    b.m_c.emplace_back((bits >> j) & 1);
+                }
+            }
+        }
+
+        m_todo.emplace_back(std::move(b));
+        m_nrequested += n;
+        m_cv.notify_all();
+    }
+
+    int OTPool::wait_locked(std::unique_lock<std::mutex>& lock, u32 n)
+    {
+        timespec begin, end;
+
+        // Not enough was asked for, both peers see the same shortfall
+        if (m_nrequested - m_ntaken < n) {
+            fill_locked(n - (m_nrequested - m_ntaken));
+        }
+
+        if (m_nfilled - m_ntaken < n && m_err == 0) {
+            m_nstall++;
+            clock_gettime(CLOCK_MONOTONIC, &begin);
+            m_cv.wait(lock, [&] { return m_nfilled - m_ntaken >= n || m_err != 0; });
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            m_stall_ms += (end.tv_sec - begin.tv_sec) * 1e3 + (end.tv_nsec - begin.tv_nsec) / 1e6;
+        }
+
+        return m_err;
+    }
+
+    void OTPool::refill_locked()
+    {
+        if (!m_stop && m_batch > 0 && m_nrequested - m_ntaken < m_low) {
+            fill_locked(m_batch);
+        }
+    }
+
+    int OTPool::take(u32 n, LabelVec& m0, LabelVec& m1)
+    {
+        std::unique_lock<std::mutex> lock(m_mtx);
+
+        GASSERT(m_pid == 0);
+        REQUIRE_GOOD_STATUS(wait_locked(lock, n));
+
+        m0.assign(m_m0.begin(), m_m0.begin() + n);
+        m1.assign(m_m1.begin(), m_m1.begin() + n);
+        m_m0.erase(m_m0.begin(), m_m0.begin() + n);
+        m_m1.erase(m_m1.begin(), m_m1.begin() + n);
+        m_ntaken += n;
+
+        refill_locked();
+        return 0;
+    }
+
+    int OTPool::take(u32 n, vector<int>& c, LabelVec& mc)
+    {
+        std::unique_lock<std::mutex> lock(m_mtx);
+
+        GASSERT(m_pid == 1);
+        REQUIRE_GOOD_STATUS(wait_locked(lock, n));
+
+        c.assign(m_c.begin(), m_c.begin() + n);
+        mc.assign(m_m0.begin(), m_m0.begin() + n);
+        m_c.erase(m_c.begin(), m_c.begin() + n);
+        m_m0.erase(m_m0.begin(), m_m0.begin() + n);
+        m_ntaken += n;
+
+        refill_locked();
+        return 0;
+    }
+
+    OTPoolStats OTPool::stats()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        OTPoolStats s;
+
+        s.m_nfilled = m_nfilled;
+        s.m_ntaken = m_ntaken;
+        s.m_size = m_nfilled - m_ntaken;
+        s.m_fill_rate = m_fill_ms > 0 ? m_nfilled / (m_fill_ms / 1e3) : 0;
+        s.m_nstall = m_nstall;
+        s.m_stall_ms = m_stall_ms;
+        return s;
+    }
+
+    void OTPool::run()
+    {
+        Batch b;
+        map<u32, int> selects;
+        map<u32, block> idlblmap;
+        timespec begin, end;
+        int err;
+
+        while (true) {
+
+            {
+                std::unique_lock<std::mutex> lock(m_mtx);
+                m_cv.wait(lock, [&] { return m_stop || !m_todo.empty(); });
+
+                // The peer queued the same batches and runs them before it
+                // stops too, unless one already failed
+                if (m_todo.empty() || (m_stop && m_err != 0)) {
+                    return;
+                }
+                b = std::move(m_todo.front());
+                m_todo.pop_front();
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &begin);
+
+            if (m_pid == 0) {
+                err = m_ot->OTSend(m_peer_ip, m_port, b.m_m0, b.m_m1);
+            } else {
+                selects.clear();
+                idlblmap.clear();
+                for (u32 i = 0; i < b.m_c.size(); i++) {
+                    selects.emplace(i, b.m_c[i]);
+                }
+                err = m_ot->OTRecv(m_peer_ip, m_port, selects, idlblmap);
+
+                // Ordered by index, as the choices
+                b.m_m0.clear();
+                for (auto& it : idlblmap) {
+                    b.m_m0.emplace_back(it.second);
+                }
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                if (err < 0) {
+                    WARNING("Random OT batch failed: " << err);
+                    m_err = err;
+                } else {
+                    m_m0.insert(m_m0.end(), b.m_m0.begin(), b.m_m0.end());
+                    m_m1.insert(m_m1.end(), b.m_m1.begin(), b.m_m1.end());
+                    m_c.insert(m_c.end(), b.m_c.begin(), b.m_c.end());
+                    m_nfilled += b.m_m0.size();
+                    m_fill_ms += (end.tv_sec - begin.tv_sec) * 1e3 + (end.tv_nsec - begin.tv_nsec) / 1e6;
+                }
+            }
+            m_cv.notify_all();
+        }
+    }
+
+}
@@ -0,0 +1,191 @@
+/*
+ * otpool.hh -- Pool of random OTs precomputed ahead of the online phase
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GASH_GC_OTPOOL_H
+#define GASH_GC_OTPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "../include/common.hh"
+#include "ot.hh"
+
+namespace gashgc {
+
+  struct OTPoolStats {
+
+    /// Random OTs produced and consumed so far
+    u64                 m_nfilled = 0;
+    u64                 m_ntaken = 0;
+
+    /// Random OTs ready to be taken
+    u64                 m_size = 0;
+
+    /// Random OTs produced per second of OT extension
+    double              m_fill_rate = 0;
+
+    /// Number of take() calls that had to wait for the filler, and how long
+    u64                 m_nstall = 0;
+    double              m_stall_ms = 0;
+  };
+
+  /**
+   * Random OT Pool
+   *
+   * A background thread runs OT extension on random messages (sender) or
+   * random choice bits (receiver) and keeps the results. Online, a real OT on
+   * labels x0, x1 with choice b takes one random OT and one round:
+   *
+   *   receiver -> sender    d = b ^ c
+   *   sender -> receiver    e0 = x0 ^ m[d], e1 = x1 ^ m[1 - d]
+   *
+   * and the receiver recovers x_b = e_b ^ m_c.
+   *
+   * Both peers must make the same sequence of fill() and take() calls: the
+   * batches are the OTs they run against each other. Refills are decided on
+   * counts both sides share, never on how far the filler has got.
+   *
+   */
+  class OTPool {
+  public:
+
+    /// Queue a batch of m_batch OTs once fewer than m_low are left
+    /// unclaimed, 0 to only fill on demand
+    u32                 m_low = 0;
+    u32                 m_batch = 0;
+
+    /**
+     * Start the filler thread, which uses `ot` for every batch
+     *
+     * @param ot Session with the peer, owned by the caller
+     * @param pid 0 for the sender, 1 for the receiver
+     * @param peer_ip
+     * @param port
+     */
+    OTPool(OTParty* ot, u32 pid, string peer_ip, u16 port);
+
+    /**
+     * Stop queuing refills, run the batches already queued to completion and
+     * join the filler thread. The peer queued the same batches, so both
+     * fillers stop after the same OT
+     *
+     */
+    ~OTPool();
+
+    /**
+     * Queue a batch of n random OTs, return without waiting for them
+     *
+     * @param n
+     */
+    void fill(u32 n);
+
+    /**
+     * Take n random OTs as the sender, waiting for the filler if needed
+     *
+     * @param n
+     * @param m0
+     * @param m1
+     *
+     * @return 0 if success, the error of the failed batch otherwise
+     */
+    int take(u32 n, LabelVec& m0, LabelVec& m1);
+
+    /**
+     * Take n random OTs as the receiver, waiting for the filler if needed
+     *
+     * @param n
+     * @param c Random choice bits
+     * @param mc The messages chosen by c
+     *
+     * @return 0 if success, the error of the failed batch otherwise
+     */
+    int take(u32 n, vector<int>& c, LabelVec& mc);
+
+    /**
+     * Fill level, rate and stalls so far
+     *
+     * @return
+     */
+    OTPoolStats stats();
+
+  private:
+
+    struct Batch {
+      LabelVec          m_m0;
+      LabelVec          m_m1;
+      vector<int>       m_c;
+    };
+
+    OTParty*            m_ot;
+    u32                 m_pid;
+    string              m_peer_ip;
+    u16                 m_port;
+
+    std::thread         m_filler;
+    std::mutex          m_mtx;
+    std::condition_variable m_cv;
+    bool                m_stop = false;
+    int                 m_err = 0;
+
+    /// Batches waiting for the filler, with their random inputs drawn
+    std::deque<Batch>   m_todo;
+
+    /// Random OTs ready to be taken. The receiver keeps m_c[i] and the chosen
+    /// message in m_m0[i]
+    std::deque<block>   m_m0;
+    std::deque<block>   m_m1;
+    std::deque<int>     m_c;
+
+    u64                 m_nrequested = 0;
+    u64                 m_nfilled = 0;
+    u64                 m_ntaken = 0;
+    double              m_fill_ms = 0;
+    u64                 m_nstall = 0;
+    double              m_stall_ms = 0;
+
+    /**
+     * fill() with m_mtx held
+     *
+     */
+    void fill_locked(u32 n);
+
+    /**
+     * Make sure n OTs are requested and filled, with m_mtx held
+     *
+     */
+    int wait_locked(std::unique_lock<std::mutex>& lock, u32 n);
+
+    /**
+     * Queue the next batch if the unclaimed OTs fell below m_low
+     *
+     */
+    void refill_locked();
+
+    /**
+     * Body of the filler thread
+     *
+     */
+    void run();
+  };
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * pool.cc -- Worker pool for running the gates of a level in parallel
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pool.hh"
+
+namespace gashgc {
+
+    WorkerPool::WorkerPool(u32 nthread)
+        : m_gen(0), m_stop(false), m_next(0), m_busy(0)
+    {
+        for (u32 i = 1; i < nthread; i++) {
+            m_workers.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_stop = true;
+            m_gen++;
+        }
+        m_cv.notify_all();
+
+        for (auto& t : m_workers) {
+            t.join();
+        }
+    }
+
+    void WorkerPool::drain()
+    {
+        u32 i;
+
+        while ((i = m_next.fetch_add(1)) < m_ntask) {
+            (*m_task)(i);
+        }
+    }
+
+    void WorkerPool::run(u32 ntask, const std::function<void(u32)>& task)
+    {
+        if (m_workers.empty() || ntask < 2) {
+            for (u32 i = 0; i < ntask; i++) {
+                task(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_task = &task;
+            m_ntask = ntask;
+            m_next = 0;
+            m_busy = m_workers.size();
+            m_gen++;
+        }
+        m_cv.notify_all();
+
+        drain();
+
+        // Levels are short, wait for the stragglers without sleeping
+        while (m_busy.load() > 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    void WorkerPool::work()
+    {
+        u64 seen = 0;
+
+        while (true) {
+
+            // Poll for a while, consecutive levels follow each other closely
+            for (u32 i = 0; i < POOL_SPIN && m_gen.load() == seen; i++) {
+                std::this_thread::yield();
+            }
+
+            if (m_gen.load() == seen) {
+                std::unique_lock<std::mutex> lock(m_mtx);
+                m_cv.wait(lock, [&] { return m_gen.load() != seen; });
+            }
+
+            seen = m_gen.load();
+            if (m_stop.load()) {
+                return;
+            }
+
+            drain();
+            m_busy--;
+        }
+    }
+
+}
@@ -0,0 +1,107 @@
+/*
+ * pool.hh -- Worker pool for running the gates of a level in parallel
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GASH_GC_POOL_H
+#define GASH_GC_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "../include/common.hh"
+
+/// Times an idle worker polls for new work before it goes to sleep
+#define POOL_SPIN 4096
+
+namespace gashgc {
+
+  /**
+   * Worker Pool
+   *
+   * A fixed set of threads that run the tasks of one call to run() and then
+   * wait for the next call. Tasks are handed out one at a time from a shared
+   * counter, so a thread that finishes early keeps taking tasks and ragged
+   * work evens out. The calling thread works too.
+   *
+   */
+  class WorkerPool {
+  public:
+
+    /**
+     * Start `nthread - 1` workers, the caller of run() is the last one
+     *
+     * @param nthread
+     */
+    WorkerPool(u32 nthread);
+
+    /**
+     * Stop and join the workers
+     *
+     */
+    ~WorkerPool();
+
+    /**
+     * Run task(0) .. task(ntask - 1) across the pool, return when all are done
+     *
+     * @param ntask
+     * @param task
+     */
+    void run(u32 ntask, const std::function<void(u32)>& task);
+
+    /**
+     * Number of threads, including the caller
+     *
+     * @return
+     */
+    u32 size() { return m_workers.size() + 1; }
+
+  private:
+
+    vector<std::thread>                    m_workers;
+
+    std::mutex                             m_mtx;
+    std::condition_variable                m_cv;
+
+    /// Bumped by every run(), workers wake up when it changes
+    std::atomic<u64>                       m_gen;
+    std::atomic<bool>                      m_stop;
+
+    const std::function<void(u32)>*        m_task = NULL;
+    u32                                    m_ntask = 0;
+    std::atomic<u32>                       m_next;
+    std::atomic<u32>                       m_busy;
+
+    /**
+     * Take tasks until none is left
+     *
+     */
+    void drain();
+
+    /**
+     * Body of a worker thread
+     *
+     */
+    void work();
+  };
+
+}
+
+#endif
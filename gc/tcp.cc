@@ -240,15 +240,108 @@ namespace gashgc {
         return 0;
     }
 
+    /**
+   * Send bytes in large frames
+   *
+   */
+    int tcp_send_bulk(int socket, const char* src, u64 size)
+    {
+
+        u64 off = 0;
+        u32 chunk;
+        struct iovec iov[2];
+        ssize_t sent;
+
+        while (off < size) {
+
+            chunk = size - off < TCP_BULK_CHUNK ? (u32)(size - off) : TCP_BULK_CHUNK;
+
+            iov[0].iov_base = &chunk;
+            iov[0].iov_len = sizeof(u32);
+            iov[1].iov_base = (void*)(src + off);
+            iov[1].iov_len = chunk;
+
+            // writev may stop anywhere in the frame, resume from there
+            while (iov[0].iov_len + iov[1].iov_len > 0) {
+
+                sent = writev(socket, iov[0].iov_len > 0 ? iov : iov + 1, iov[0].iov_len > 0 ? 2 : 1);
+
+                if (sent < 0) {
+
+                    WARNING("tcp_send_bulk error: Unable to send frame of size " << chunk << "\n");
+
+                    return -G_ETCP;
+                }
+
+                for (int i = 0; i < 2 && sent > 0; i++) {
+                    size_t n = (size_t)sent < iov[i].iov_len ? (size_t)sent : iov[i].iov_len;
+                    iov[i].iov_base = (char*)iov[i].iov_base + n;
+                    iov[i].iov_len -= n;
+                    sent -= n;
+                }
+            }
+
+            off += chunk;
+        }
+
+        ac_sent_amt += size;
+        return 0;
+    }
+
+    /**
+   * Receive bytes sent in large frames
+   *
+   */
+    int tcp_recv_bulk(int socket, char* dest, u64 size)
+    {
+
+        u64 off = 0;
+        u32 chunk;
+
+        while (off < size) {
+
+            if (recv(socket, &chunk, sizeof(u32), MSG_WAITALL) != sizeof(u32)) {
+
+                WARNING("tcp_recv_bulk error: Unable to receive frame size\n");
+
+                return -G_ETCP;
+            }
+
+            if (chunk == 0 || chunk > size - off) {
+
+                WARNING("tcp_recv_bulk error: Frame of size " << chunk << " overruns " << size - off << " remaining bytes\n");
+
+                return -G_ETCP;
+            }
+
+            if (recv(socket, dest + off, chunk, MSG_WAITALL) != (ssize_t)chunk) {
+
+                WARNING("tcp_recv_bulk error: Unable to receive frame of size " << chunk << "\n");
+
+                return -G_ETCP;
+            }
+
+            off += chunk;
+        }
+
+        ac_recv_amt += size;
+        return 0;
+    }
+
     int tcp_send_mpz(int sock, mpz_class& mpz)
     {
-        string buf = mpz.get_str(10);
-        int size = buf.size();
+        size_t count = 0;
+        int size = (mpz_sizeinbase(mpz.get_mpz_t(), 2) + 7) / 8;
         char cbuf[size];
-        memcpy(cbuf, buf.c_str(), size + 1);
+
+        // Magnitude as little-endian bytes, the sign goes with the length
+        mpz_export(cbuf, &count, -1, 1, -1, 0, mpz.get_mpz_t());
+        size = mpz_sgn(mpz.get_mpz_t()) < 0 ? -(int)count : (int)count;
 
         REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, (char*)&size, sizeof(size)));
-        REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, cbuf, size));
+        if (count > 0) {
+            REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, cbuf, count));
+        }
 
         return 0;
     }
@@ -258,15 +351,92 @@ namespace gashgc {
         int size;
         REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, (char*)&size, sizeof(size)));
 
-        char cbuf[size+1];
-        memset(cbuf, 0, size+1);
-        REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, cbuf, size));
+        if (size == 0) {
+            mpz = 0;
+            return 0;
+        }
 
-        mpz_set_str(mpz.get_mpz_t(), cbuf, 10);
+        u32 count = size < 0 ? -size : size;
+        char cbuf[count];
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, cbuf, count));
+
+        mpz_import(mpz.get_mpz_t(), count, -1, 1, -1, 0, cbuf);
+        if (size < 0) {
+            mpz = -mpz;
+        }
 
         return 0;
     }
 
+    int tcp_send_mpz_vec(int sock, const vector<mpz_class>& vec, u32 nbits)
+    {
+        u32 n = vec.size();
+        u32 width = (nbits + 7) / 8;
+        vector<char> buf((size_t)n * width, 0);
+        mpz_class tmp;
+
+        REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, (char*)&n, sizeof(u32)));
+        if (n == 0) {
+            return 0;
+        }
+
+        for (u32 i = 0; i < n; ++i) {
+
+            // Non-negative representative, so every element is `width` bytes at most
+            mpz_fdiv_r_2exp(tmp.get_mpz_t(), vec[i].get_mpz_t(), nbits);
+            mpz_export(buf.data() + (size_t)i * width, NULL, -1, 1, -1, 0, tmp.get_mpz_t());
+        }
+
+        return tcp_send_bulk(sock, buf.data(), buf.size());
+    }
+
+    int tcp_recv_mpz_vec(int sock, vector<mpz_class>& vec, u32 nbits)
+    {
+        u32 n;
+        u32 width = (nbits + 7) / 8;
+
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, (char*)&n, sizeof(u32)));
+        vec.resize(n);
+        if (n == 0) {
+            return 0;
+        }
+
+        vector<char> buf((size_t)n * width);
+        REQUIRE_GOOD_STATUS(tcp_recv_bulk(sock, buf.data(), buf.size()));
+
+        for (u32 i = 0; i < n; ++i) {
+            mpz_import(vec[i].get_mpz_t(), width, -1, 1, -1, 0, buf.data() + (size_t)i * width);
+        }
+
+        return 0;
+    }
+
+    int tcp_send_u64_vec(int sock, const vector<u64>& vec)
+    {
+        u32 n = vec.size();
+
+        REQUIRE_GOOD_STATUS(tcp_send_bytes(sock, (char*)&n, sizeof(u32)));
+        if (n == 0) {
+            return 0;
+        }
+
+        // Already little-endian in memory on the hosts we run on
+        return tcp_send_bulk(sock, (const char*)vec.data(), (u64)n * sizeof(u64));
+    }
+
+    int tcp_recv_u64_vec(int sock, vector<u64>& vec)
+    {
+        u32 n;
+
+        REQUIRE_GOOD_STATUS(tcp_recv_bytes(sock, (char*)&n, sizeof(u32)));
+        vec.resize(n);
+        if (n == 0) {
+            return 0;
+        }
+
+        return tcp_recv_bulk(sock, (char*)vec.data(), (u64)n * sizeof(u64));
+    }
+
     int tcp_report()
     {
         cout << "Accumulated send amount:" << ac_sent_amt << endl;
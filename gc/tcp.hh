@@ -24,11 +24,15 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "../include/common.hh"
 
 namespace gashgc {
 
+/// Largest frame written by tcp_send_bulk
+#define TCP_BULK_CHUNK (1 << 20)
+
     /**
    * Server initialization: create socket, bind, listen, and accept
    *
@@ -82,7 +86,32 @@ namespace gashgc {
     int tcp_recv_bytes(int socket, char* dest, u32 size);
 
     /**
-     * Send mpz
+     * Send `size` bytes over socket as frames of at most TCP_BULK_CHUNK bytes.
+     * Every frame is written with a single writev, straight from `src`. Each
+     * frame starts with its u32 length, so only tcp_recv_bulk can read them
+     *
+     * @param socket
+     * @param src
+     * @param size
+     *
+     * @return 0 if success, -G_ETCP if failure
+     */
+    int tcp_send_bulk(int socket, const char* src, u64 size);
+
+    /**
+     * Receive `size` bytes sent by tcp_send_bulk straight into `dest`
+     *
+     * @param socket
+     * @param dest
+     * @param size
+     *
+     * @return 0 if success, -G_ETCP if failure or if a frame overruns `size`
+     */
+    int tcp_recv_bulk(int socket, char* dest, u64 size);
+
+    /**
+     * Send mpz, exactly, as a signed byte count and the magnitude in
+     * little-endian bytes
      *
      * @param sock
      * @param mpz
@@ -101,6 +130,50 @@ namespace gashgc {
      */
     int tcp_recv_mpz(int sock, mpz_class& mpz);
 
+    /**
+     * Send a vector of ring elements mod 2^nbits in one message, each as
+     * (nbits + 7) / 8 little-endian bytes. Negative values are sent as their
+     * representative in [0, 2^nbits)
+     *
+     * @param sock
+     * @param vec
+     * @param nbits
+     *
+     * @return 0 if success, -G_ETCP if failure
+     */
+    int tcp_send_mpz_vec(int sock, const vector<mpz_class>& vec, u32 nbits);
+
+    /**
+     * Receive a vector sent by tcp_send_mpz_vec with the same nbits
+     *
+     * @param sock
+     * @param vec Resized to the number of elements sent
+     * @param nbits
+     *
+     * @return 0 if success, -G_ETCP if failure
+     */
+    int tcp_recv_mpz_vec(int sock, vector<mpz_class>& vec, u32 nbits);
+
+    /**
+     * Send a vector of 64-bit ring elements in one message, little-endian
+     *
+     * @param sock
+     * @param vec
+     *
+     * @return 0 if success, -G_ETCP if failure
+     */
+    int tcp_send_u64_vec(int sock, const vector<u64>& vec);
+
+    /**
+     * Receive a vector sent by tcp_send_u64_vec
+     *
+     * @param sock
+     * @param vec Resized to the number of elements sent
+     *
+     * @return 0 if success, -G_ETCP if failure
+     */
+    int tcp_recv_u64_vec(int sock, vector<u64>& vec);
+
     /**
    * Report send and recv statistics
    *
@@ -187,6 +187,36 @@ namespace gashgc {
         return inv ? eval_bgate(a, b, func) ^ 1 : eval_bgate(a, b, func);
     }
 
+    int split_bgate(int func, int& alpha, int& beta, int& gamma)
+    {
+
+        int ones = 0;
+        int odd = 0;
+
+        for (int i = 0; i < 4; i++) {
+            ones += getbit(func, i);
+        }
+
+        if (ones % 2 == 0) {
+            gamma = getbit(func, 0);
+            alpha = getbit(func, 1) ^ gamma;
+            beta = getbit(func, 2) ^ gamma;
+            return 0;
+        }
+
+        // The odd one out is the only row where (a ^ alpha) & (b ^ beta) is 1
+        gamma = ones == 3 ? 1 : 0;
+        for (int i = 0; i < 4; i++) {
+            if ((getbit(func, i)) != gamma) {
+                odd = i;
+            }
+        }
+        alpha = (odd & 1) ^ 1;
+        beta = (odd >> 1) ^ 1;
+
+        return 1;
+    }
+
     block new_tweak(u32 id)
     {
 
@@ -161,6 +161,21 @@ namespace gashgc {
    */
   u32 eval_gate(int a, int b, int func, bool inverted);
 
+  /**
+   * Split a binary gate function into the form used by half-gates garbling.
+   * A function with an odd number of 1s in its truth table is written as
+   * ((a ^ alpha) & (b ^ beta)) ^ gamma, any other one is affine and is
+   * written as gamma ^ (alpha & a) ^ (beta & b)
+   *
+   * @param func
+   * @param alpha
+   * @param beta
+   * @param gamma
+   *
+   * @return 1 if func is AND-like, 0 if it is affine
+   */
+  int split_bgate(int func, int& alpha, int& beta, int& gamma);
+
 
   /**
    * Get least significant bit
@@ -0,0 +1,91 @@
+/*
+ * bcirc.hh -- Binary compiled circuit format, shared by the compiler and the
+ * garbled circuit loader
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GASH_BCIRC_H
+#define GASH_BCIRC_H
+
+#include "common.hh"
+
+/*
+ * A binary circuit file carries the same records as the text circuit file, as
+ * native endian u32 words so that it can be mapped and read in place:
+ *
+ *   BcircHeader
+ *   u32          input wire, nin_rec of them      (text: I:<idx>)
+ *   BcircOutput  output wire, nout_rec of them    (text: O:<idx>[:<val>])
+ *   BcircGate    gate, ngate of them              (text: <out> <func> <in0> <in1>)
+ *   u64          bcirc_hash of every word above
+ *
+ * Wire indices are encoded as in the text file, id * 2 plus 1 if inverted.
+ */
+
+#define bcirc_magic_num 0x63726362      // "bcrc"
+#define BCIRC_VERSION   1
+
+/// BcircOutput::m_val of an output that is not a constant
+#define BCIRC_NO_VAL    0xffffffff
+
+struct BcircHeader {
+    u32 m_magic;
+    u32 m_version;
+
+    /// Prologue of the text file
+    u32 m_nvar;
+    u32 m_nin;
+    u32 m_nout;
+
+    /// Number of records in each table
+    u32 m_nin_rec;
+    u32 m_nout_rec;
+    u32 m_ngate;
+};
+
+struct BcircOutput {
+    u32 m_idx;
+    u32 m_val;
+};
+
+struct BcircGate {
+    u32 m_out;
+    u32 m_func;
+    u32 m_in0;
+    u32 m_in1;
+};
+
+#define BCIRC_HASH_INIT 0xcbf29ce484222325ULL
+
+/**
+ * FNV-1a over 32-bit words, one multiply per word
+ *
+ * @param h Hash so far, BCIRC_HASH_INIT to start
+ * @param w
+ * @param n Number of words
+ *
+ * @return
+ */
+inline u64 bcirc_hash(u64 h, const u32* w, u64 n)
+{
+    for (u64 i = 0; i < n; i++) {
+        h = (h ^ w[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#endif
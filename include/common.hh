@@ -119,6 +119,8 @@ typedef int64_t i64;
 
 #define xor_magic_num 0x10179394
 #define nonxor_magic_num 0x00000639
+#define halfgate_magic_num 0x00000a2b
+#define egtt_bulk_magic_num 0x0e97b01c
 
 #define CONC2(x, y) x##y
 #define CONC1(x, y) CONC2(x, y)
@@ -18,6 +18,7 @@
  */
 
 #include "circuit.hh"
+#include "../include/bcirc.hh"
 
 namespace gashlang {
 
@@ -343,13 +344,71 @@ namespace gashlang {
 
     void Circuit::write()
     {
-        m_prologue.emit(*m_circ_stream);
-        write_inwires();
-        write_outwires();
-        m_gates.emit(*m_circ_stream);
+        if (m_binary) {
+            write_binary();
+        } else {
+            m_prologue.emit(*m_circ_stream);
+            write_inwires();
+            write_outwires();
+            m_gates.emit(*m_circ_stream);
+        }
         write_input();
     }
 
+    void Circuit::write_binary()
+    {
+        ostream&     stream = *m_circ_stream;
+        vector<u32>  buf;
+        u64          hash = BCIRC_HASH_INIT;
+        BcircHeader  hdr;
+        Wire*        w;
+
+        // Words are hashed and written a buffer at a time
+        auto flush = [&]() {
+            hash = bcirc_hash(hash, buf.data(), buf.size());
+            stream.write((const char*)buf.data(), buf.size() * sizeof(u32));
+            buf.clear();
+        };
+
+        auto put = [&](u32 word) {
+            buf.push_back(word);
+            if (buf.size() == (1 << 16)) {
+                flush();
+            }
+        };
+
+        hdr.m_magic = bcirc_magic_num;
+        hdr.m_version = BCIRC_VERSION;
+        hdr.m_nvar = m_prologue.numVAR;
+        hdr.m_nin = m_prologue.numIN;
+        hdr.m_nout = m_prologue.numOUT;
+        hdr.m_nin_rec = m_in.size();
+        hdr.m_nout_rec = m_out.size();
+        hdr.m_ngate = m_gates.m_gates.size();
+        buf.assign((u32*)&hdr, (u32*)(&hdr + 1));
+
+        // Same wire indices as write_inwires, write_outwires and Gate::emit
+        for (u32 i = 0; i < m_in.size(); ++i) {
+            put(evenify(m_in[i]->m_id));
+        }
+
+        for (u32 i = 0; i < m_out.size(); ++i) {
+            w = m_out[i];
+            put(w->m_id);
+            put(w->m_v == 0 || w->m_v == 1 ? w->m_v : BCIRC_NO_VAL);
+        }
+
+        for (Gate* g : m_gates.m_gates) {
+            put(evenify(g->m_out->m_id));
+            put(g->m_op);
+            put(g->m_in0->m_id);
+            put(g->m_in1->m_id);
+        }
+
+        flush();
+        stream.write((const char*)&hash, sizeof(u64));
+    }
+
     void Circuit::write_input()
     {
 
@@ -362,10 +421,45 @@ namespace gashlang {
           w = m_in[i];
           id = w->m_id;
           val = w->m_v;
-          if (val == 0 || val == 1)
+          if (val == 0 || val == 1) {
             stream << evenify(id) << ' ' << val << endl;
+
+            auto it = m_input_src.find(id);
+            if (it != m_input_src.end()) {
+              m_input_layout.push_back(it->second);
+            } else {
+              m_input_layout.push_back({(u32)evenify(id), string(), 0, (u32)val});
+            }
+          }
+        }
+
+    }
+
+    void Circuit::set_input_src(Wire* w, string var, u32 bit, u32 flip)
+    {
+        m_input_src[w->m_id] = {(u32)evenify(w->m_id), var, bit, flip};
+    }
+
+    int write_input(const InputLayout& layout, const map<string, i64>& vals, ostream& stream,
+                    u32 id_offset)
+    {
+        u32 val;
+
+        for (auto& in : layout) {
+            if (in.m_var.empty()) {
+                val = in.m_val;
+            } else {
+                auto it = vals.find(in.m_var);
+                if (it == vals.end()) {
+                    WARNING("No value for input " << in.m_var);
+                    return -G_ENOENT;
+                }
+                val = (getbit(it->second, in.m_bit)) ^ in.m_val;
+            }
+            stream << in.m_id + id_offset << ' ' << val << endl;
         }
 
+        return 0;
     }
 
     void Circuit::add_wire(Wire* w)
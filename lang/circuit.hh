@@ -45,6 +45,20 @@ namespace gashlang {
   typedef map<u32, Wire*> IdWireMap;
   typedef vector<u32> Bits;
 
+  /**
+   * Source of one line of the data file: bit `m_bit` of input directive
+   * `m_var`, xor `m_val`. A line with an empty `m_var` is the constant `m_val`
+   *
+   */
+  struct InputBit {
+    u32     m_id;
+    string  m_var;
+    u32     m_bit;
+    u32     m_val;
+  };
+
+  typedef vector<InputBit> InputLayout;
+
   /**
    * The wire class
    *
@@ -276,6 +290,20 @@ namespace gashlang {
    */
   void num2bundle(i64 v, Bundle& bundle);
 
+  /**
+   * Write a data file with new directive values, laid out like the one an
+   * earlier parse wrote. Values are taken bit by bit, as by #definput
+   *
+   * @param layout
+   * @param vals Directive name -> value
+   * @param stream
+   * @param id_offset Added to every wire id written, for replicated circuits
+   *
+   * @return 0 if success, -G_ENOENT if a directive of `layout` has no value
+   */
+  int write_input(const InputLayout& layout, const map<string, i64>& vals, ostream& stream,
+                  u32 id_offset = 0);
+
   /**
    * Prologue is responsible for writing the first line of the output circuit.
    *
@@ -340,9 +368,18 @@ namespace gashlang {
     IdWireMap     m_wires;
     IdIdMap       m_input_dup;
     IdIdMap       m_wire_inverts;
+
+    /// Input wire id -> the directive bit that sets it
+    map<u32, InputBit> m_input_src;
+
+    /// Every line written to data_stream so far, in order
+    InputLayout   m_input_layout;
     ostream*      m_circ_stream = NULL;
     ostream*      m_data_stream = NULL;
 
+    /// Write the circuit in the binary format of include/bcirc.hh
+    bool          m_binary = false;
+
     Circuit() {
       m_prologue = Prologue();
       m_prologue.numAND = 0;
@@ -374,12 +411,29 @@ namespace gashlang {
      */
     void write_outwires();
 
+    /**
+     * Write the prologue, input/output wires and gates to circ_stream in the
+     * binary format of include/bcirc.hh
+     *
+     */
+    void write_binary();
+
     /**
      * Write input to data_stream.
      *
      */
     void write_input();
 
+    /**
+     * Record that input wire `w` is bit `bit` of directive `var`, xor `flip`
+     *
+     * @param w
+     * @param var
+     * @param bit
+     * @param flip
+     */
+    void set_input_src(Wire* w, string var, u32 bit, u32 flip);
+
     /**
      * Add wire to circuit
      *
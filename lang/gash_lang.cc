@@ -814,6 +814,7 @@ namespace gashlang {
                 }
                 GASSERT(mgc.m_in.getWire(id) == w); // Require one pointer to a wire
                 w->m_v = getbit(val, i);
+                mgc.set_input_src(w, sym->m_name, i, 0);
 
                 if (mgc.m_input_dup.find(id) != mgc.m_input_dup.end()) {
                     // Found input duplicate
@@ -824,6 +825,7 @@ namespace gashlang {
 
                     w_dup = mgc.m_in.getWire(id_dup);
                     w_dup->m_v = getbit(val, i) ^ 1;
+                    mgc.set_input_src(w_dup, sym->m_name, i, 1);
                 }
             }
 
@@ -1001,6 +1003,16 @@ namespace gashlang {
         mgc.set_data_outstream(data_ofstream);
     }
 
+    void set_binary_circuit(bool binary)
+    {
+        mgc.m_binary = binary;
+    }
+
+    InputLayout& get_input_layout()
+    {
+        return mgc.m_input_layout;
+    }
+
     void run(ofstream& circ_file,
         ofstream& data_file,
         const char* circ_out,
@@ -623,6 +623,22 @@ namespace gashlang {
    */
   void set_ofstream(ofstream& circ_ofstream, ofstream& data_ofstream);
 
+  /**
+   * Write the circuit in the binary format of include/bcirc.hh instead of
+   * text. Reset by parse_clean
+   *
+   * @param binary
+   */
+  void set_binary_circuit(bool binary);
+
+  /**
+   * Sources of the data file lines written by the last parse, so that the
+   * data can be rewritten for other input values without parsing again
+   *
+   * @return
+   */
+  InputLayout& get_input_layout();
+
   /**
    * Clean all intermediate parsing related structures.
    * Possibly for the purpose of conducting unit test.
@@ -60,6 +60,7 @@ int main(int argc, char* argv[])
         ("input,i", value<string>(), "file path of input function description file")
         ("circ,c", value<string>(), "file path of output circ file")
         ("data,d", value<string>(), "file path of output data file")
+        ("binary,b", "write the circ file in binary form, faster to load")
         ("peer_ip,p", value<string>(), "Peer IP address (If you are garbler, the you should put evaluator's ip, and vice versa)")
         ("port,t", value<string>(), "Main port used for GC communication, must be the same and available in both garbler and evaluator's machine")
         ("otport,o", value<string>(), "Port for Oblivious Transfer, must be different than main port, and be the same and available in both garbler and evaluator's machine");
@@ -142,6 +143,7 @@ int main(int argc, char* argv[])
         std::ofstream m_data_stream = ofstream(data_fname, std::ios::out | std::ios::trunc);
         yyin = fp;
         gashlang::set_ofstream(m_circ_stream, m_data_stream);
+        gashlang::set_binary_circuit(vm.count("binary") > 0);
         EXPECT_EQ_with_Timer(0, yyparse(), "Parsing");
         gashgc::Evaluator evaluator(peer_ip, port, otport, circ_fname, data_fname);
         EXPECT_EQ_with_Timer(0, evaluator.build_circ(), "Build circuit");
@@ -168,6 +170,7 @@ int main(int argc, char* argv[])
         std::ofstream m_data_stream = ofstream(data_fname, std::ios::out | std::ios::trunc);
         yyin = fp;
         gashlang::set_ofstream(m_circ_stream, m_data_stream);
+        gashlang::set_binary_circuit(vm.count("binary") > 0);
         EXPECT_EQ_with_Timer(0, yyparse(), "Parsing");
         gashgc::Garbler garbler(peer_ip, port, otport, circ_fname, data_fname);
         EXPECT_EQ_with_Timer(0, garbler.build_circ(), "Build circuit");
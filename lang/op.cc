@@ -459,14 +459,12 @@ namespace gashlang {
     {
         // Since we are using two's complement, modifications are made
         // (A > B) = A_n' & B_n |    (<--- The MSB)
-        //           (A_n invand B_n) & (A_{n-1} & B_{n-1}')
-        //           (A_n invand B_n) & (A_{n-1} ^ B_{n-1})' & (A_{n-2} & B_{n-2}')
+        //           (A_n ^ B_n)' & (A_{n-1} & B_{n-1}')
+        //           (A_n ^ B_n)' & (A_{n-1} ^ B_{n-1})' & (A_{n-2} & B_{n-2}')
         //           ...
-        //           (A_n and B_n) & (A_{n-1}' & B_{n-1})
-        //           (A_n and B_n) & (A_{n-1} ^ B_{n-1})' & (A_{n-2}' & B_{n-2})
-        //           ...
-        // Here & denotes AND, ^ denotes XOR, | denotes OR and ' denotes INV, invand denotes
-        // the binary operation where output is 1 iff both inputs are 0
+        // With equal signs the remaining bits compare as unsigned, for negative
+        // numbers as well as for positive ones.
+        // Here & denotes AND, ^ denotes XOR, | denotes OR and ' denotes INV
 
 
         GASSERT(in0.size() == in1.size());
@@ -493,38 +491,25 @@ namespace gashlang {
         Wire* used_xor;
         Wire* inv_in0;
         Wire* inv_in1;
-        Wire* and_in0_in1;
-        Wire* iand_in0_in1;
+        Wire* same_sign;
         Wire* and_in0_iin1;
-        Wire* and_iin0_in1;
-        Wire* and_in0_iin1_xor;
-        Wire* and_iin0_in1_xor;
         Wire* irow;
-        Wire* jrow;
 
         REQUIRE_GOOD_STATUS(evalw_INV(in0[len - 1], inv_in0));
         REQUIRE_GOOD_STATUS(evalw_AND(in1[len - 1], inv_in0, ret));
-        used_xor = onewire();
 
-        REQUIRE_GOOD_STATUS(evalw_IAND(in0[len - 1], in1[len - 1], iand_in0_in1));
-        REQUIRE_GOOD_STATUS(evalw_AND(in0[len - 1], in1[len - 1], and_in0_in1));
+        REQUIRE_GOOD_STATUS(evalw_XOR(in0[len - 1], in1[len - 1], tmp));
+        REQUIRE_GOOD_STATUS(evalw_INV(tmp, same_sign));
+        used_xor = same_sign;
 
         for (u32 i = 1; i < len; ++i) {
 
             REQUIRE_GOOD_STATUS(evalw_INV(in1[len - i - 1], inv_in1));
             REQUIRE_GOOD_STATUS(evalw_AND(in0[len - i - 1], inv_in1, and_in0_iin1));
-            REQUIRE_GOOD_STATUS(evalw_AND(and_in0_iin1, used_xor, and_in0_iin1_xor));
-            REQUIRE_GOOD_STATUS(evalw_AND(and_in0_iin1_xor, iand_in0_in1, irow));
+            REQUIRE_GOOD_STATUS(evalw_AND(and_in0_iin1, used_xor, irow));
             REQUIRE_GOOD_STATUS(evalw_OR(ret, irow, tmp));
             ret = tmp;
 
-            REQUIRE_GOOD_STATUS(evalw_INV(in0[len - i - 1], inv_in0));
-            REQUIRE_GOOD_STATUS(evalw_AND(in1[len - i - 1], inv_in0, and_iin0_in1));
-            REQUIRE_GOOD_STATUS(evalw_AND(and_iin0_in1, used_xor, and_iin0_in1_xor));
-            REQUIRE_GOOD_STATUS(evalw_AND(and_iin0_in1_xor, and_in0_in1, jrow));
-            REQUIRE_GOOD_STATUS(evalw_OR(ret, jrow, tmp));
-            ret = tmp;
-
             REQUIRE_GOOD_STATUS(evalw_AND(used_xor, xors[len - i - 1], tmp));
             used_xor = tmp;
 
@@ -660,27 +645,25 @@ namespace gashlang {
 
     int evalo_if(Wire* cond, Bundle& then_res, Bundle& else_res, Bundle& out)
     {
-        // out = (then_res & cond) | (else_res & cond')
+        // out = else_res ^ (cond & (then_res ^ else_res)), the XORs are free
+        // so each bit costs a single AND
         GASSERT(then_res.size() == else_res.size());
         u32 len = then_res.size();
-        Bundle left;
-        Bundle right;
+        Wire* diff;
+        Wire* sel;
         Wire* w;
-        Wire* cond_inv;
 
         out.clear();
 
         for (u32 i = 0; i < len; ++i) {
-            REQUIRE_GOOD_STATUS(evalw_AND(cond, then_res[i], w));
-            left.add(w);
-        }
-        for (u32 i = 0; i < len; ++i) {
-            REQUIRE_GOOD_STATUS(evalw_INV(cond, cond_inv));
-            REQUIRE_GOOD_STATUS(evalw_AND(cond_inv, else_res[i], w));
-            right.add(w);
-        }
-        for (u32 i = 0; i < len; ++i) {
-            REQUIRE_GOOD_STATUS(evalw_OR(left[i], right[i], w));
+            if (then_res[i] == else_res[i]) {
+                // Both branches left the bit alone
+                out.add(then_res[i]);
+                continue;
+            }
+            REQUIRE_GOOD_STATUS(evalw_XOR(then_res[i], else_res[i], diff));
+            REQUIRE_GOOD_STATUS(evalw_AND(cond, diff, sel));
+            REQUIRE_GOOD_STATUS(evalw_XOR(else_res[i], sel, w));
             out.add(w);
         }
         return 0;
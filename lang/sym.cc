@@ -33,6 +33,7 @@ namespace gashlang {
     NumSymbol::NumSymbol(NumSymbol& rhs)
         : Symbol(rhs.m_name, rhs.m_version)
     {
+        m_type = NUM;
         m_bundle = Bundle(rhs.m_bundle.size());
     }
 
@@ -45,6 +46,7 @@ namespace gashlang {
     ArraySymbol::ArraySymbol(ArraySymbol& rhs)
         : Symbol(rhs.m_name, rhs.m_version)
     {
+        m_type = ARRAY;
         Bundle b;
         for (u32 i = 0; i < rhs.m_bundles.size(); ++i) {
             b = Bundle(rhs.m_bundles[i].size());
@@ -66,6 +68,7 @@ namespace gashlang {
     FuncSymbol::FuncSymbol(FuncSymbol& rhs)
         : Symbol(rhs.m_name, rhs.m_version)
     {
+        m_type = FUNC;
         m_func = rhs.m_func;
     }
 
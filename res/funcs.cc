@@ -38,7 +38,18 @@ namespace gashres {
         "    return ret; }                             ";
 
 
-    // TODO: add multiplication and division
+    // TODO: add multiplication
+
+    const string fsrc_div =
+        "func div (intXXX a, intXXX b) {               "
+        "    intXXX ret = a / b;                       "
+        "    return ret; }                             ";
+
+    const string fsrc_mux =
+        "func mux (int1 c, intXXX a, intXXX b) {       "
+        "    intXXX ret = b;                           "
+        "    if (c) { ret = a; }                       "
+        "    return ret; }                             ";
 
     const string fsrc_relu =
         "func relu (intXXX x) {                        "
@@ -120,6 +131,8 @@ namespace gashres {
     REGISTER_FUNC(billionaire, 2, fsrc_billionaire);
     REGISTER_FUNC(add, 2, fsrc_add);
     REGISTER_FUNC(sub, 2, fsrc_sub);
+    REGISTER_FUNC(div, 2, fsrc_div);
+    REGISTER_FUNC(mux, 3, fsrc_mux);
     REGISTER_FUNC(relu, 1, fsrc_relu);
     REGISTER_FUNC(ss_relu, 3, fsrc_ss_relu);
     REGISTER_FUNC(ss_relugrad, 3, fsrc_ss_relugrad);
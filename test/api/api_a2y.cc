@@ -0,0 +1,82 @@
+/*
+ * api_a2y.cc -- Conversions between arithmetic and garbled shares
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_harness.hh"
+
+static const i64 X[] = { 5, -7, (i64)1 << 40, -((i64)1 << 33), 0 };
+static const i64 Y[] = { 3, -9, (i64)1 << 41, 2, 0 };
+
+#define N (sizeof(X) / sizeof(X[0]))
+
+static int run_peer(int id)
+{
+    vector<ring_t> x, y;
+    vector<ring_t> back, relu;
+    vector<int> la;
+
+    api_peer_init(id, true);
+
+    gash_ring_recv_shares(x);
+    gash_ring_recv_shares(y);
+
+    // Convert once, then use the garbled shares in several circuits
+    gash_gc_session_begin();
+    vector<yshare_t> yx = gash_ring_a2y_batch(x);
+    vector<yshare_t> yy = gash_ring_a2y_batch(y);
+    vector<yshare_t> yr = gash_y_relu_batch(yx);
+
+    back = gash_ring_y2a_batch(yx);
+    relu = gash_ring_y2a_batch(yr);
+    la = gash_y_la_batch(yx, yy);
+    gash_gc_session_end();
+
+    for (u32 i = 0; i < N; ++i) {
+        gash_ring_recon_slave(back[i]);
+        gash_ring_recon_slave(relu[i]);
+        if (la[i] != (X[i] > Y[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+TEST_F(APITest, A2YY2A) {
+
+    int failed = api_run(run_peer, [] {
+        vector<ring_t> x(X, X + N), y(Y, Y + N);
+        i64 v;
+
+        gash_ring_send_shares(x);
+        gash_ring_send_shares(y);
+
+        for (u32 i = 0; i < N; ++i) {
+            gash_ring_recon_master(v);
+            EXPECT_EQ(X[i], v);
+            gash_ring_recon_master(v);
+            EXPECT_EQ(X[i] > 0 ? X[i] : 0, v);
+        }
+    });
+    EXPECT_EQ(0, failed);
+}
+
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
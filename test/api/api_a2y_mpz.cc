@@ -0,0 +1,87 @@
+/*
+ * api_a2y_mpz.cc -- A2Y and Y2A of GMP shares from the whole ring
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_harness.hh"
+
+static const i64 X[] = { 5, -7, (i64)1 << 40, -((i64)1 << 33), 0, 1, -1, (i64)1 << 61 };
+
+#define N (sizeof(X) / sizeof(X[0]))
+
+static int run_peer(int id)
+{
+    vector<mpz_class> x(N);
+    vector<mpz_class> back, relu;
+    mpz_class half = 1;
+    int upper = 0;
+
+    api_peer_init(id, true);
+
+    // Both parties add 2^63, which cancels out in the ring. The shares stay
+    // representatives in [0, 2^64), party 0's all in the upper half
+    mpz_mul_2exp(half.get_mpz_t(), half.get_mpz_t(), CONFIG_L - 1);
+    for (u32 i = 0; i < N; ++i) {
+        gash_ss_recv_share(x[i]);
+        x[i] += half;
+        mpz_fdiv_r_2exp(x[i].get_mpz_t(), x[i].get_mpz_t(), CONFIG_L);
+        upper += x[i] >= half;
+    }
+    if (id == 0 && upper != (int)N) {
+        return 1;
+    }
+
+    gash_gc_session_begin();
+    vector<yshare_t> yx = gash_ss_a2y_batch(x);
+    vector<yshare_t> yr = gash_y_relu_batch(yx);
+
+    back = gash_ss_y2a_batch(yx);
+    relu = gash_ss_y2a_batch(yr);
+    gash_gc_session_end();
+
+    for (u32 i = 0; i < N; ++i) {
+        gash_ss_recon_slave(back[i]);
+        gash_ss_recon_slave(relu[i]);
+    }
+    return 0;
+}
+
+TEST_F(APITest, MpzA2YY2A) {
+
+    int failed = api_run(run_peer, [] {
+        mpz_class v;
+
+        for (u32 i = 0; i < N; ++i) {
+            v = X[i];
+            gash_ss_send_share(v);
+        }
+
+        for (u32 i = 0; i < N; ++i) {
+            gash_ss_recon_master(v);
+            EXPECT_TRUE(v == X[i]) << i << ": " << v;
+            gash_ss_recon_master(v);
+            EXPECT_TRUE(v == (X[i] > 0 ? X[i] : 0)) << i << ": " << v;
+        }
+    });
+    EXPECT_EQ(0, failed);
+}
+
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,117 @@
+/*
+ * api_harness.hh -- Two parties and a client of the API tests in one process tree
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GASH_TEST_API_HARNESS_H
+#define GASH_TEST_API_HARNESS_H
+
+#include "../include/common.hh"
+#include "../../api/gash.hh"
+#include <csignal>
+#include <sys/wait.h>
+
+#define g_ip "127.0.0.1"
+#define e_ip "127.0.0.1"
+#define c_ip "127.0.0.1"
+
+/**
+ * Initialize party `id`, 0 as the garbler and 1 as the evaluator, and connect
+ * it to the client. With `gc` the parties also connect to each other for
+ * garbled circuits
+ *
+ */
+static inline void api_peer_init(int id, bool gc = false)
+{
+    gash_config_init();
+    if (id == 0) {
+        gash_init_as_garbler(e_ip);
+        if (gc) {
+            gash_connect_peer();
+        }
+        gash_ss_garbler_init(c_ip);
+    } else {
+        gash_init_as_evaluator(g_ip);
+        if (gc) {
+            gash_connect_peer();
+        }
+        gash_ss_evaluator_init(c_ip, g_ip);
+    }
+}
+
+/**
+ * Wait for child `pid`, nonzero unless it exited normally with status 0
+ *
+ */
+static inline int api_wait(pid_t pid)
+{
+    int status;
+
+    if (waitpid(pid, &status, 0) != pid) {
+        return 1;
+    }
+    return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+/**
+ * Fork party 0 and party 1, each runs `peer(id)` and exits with what it
+ * returns. This process initializes the client, runs `client()` and reaps
+ * both parties. A party that aborts counts as failed
+ *
+ * @param peer int(int), nonzero on failure
+ * @param client void()
+ *
+ * @return 0 if both parties exited with 0
+ */
+template <typename Peer, typename Client>
+static int api_run(Peer peer, Client client)
+{
+    pid_t p0, p1;
+    int failed = 0;
+
+    p0 = fork();
+    if (p0 < 0) {
+        return 1;
+    }
+    if (p0 == 0) {
+        // First child is peer0 / garbler
+        sleep(1);
+        _exit(peer(0));
+    }
+    p1 = fork();
+    if (p1 < 0) {
+        kill(p0, SIGKILL);
+        api_wait(p0);
+        return 1;
+    }
+    if (p1 == 0) {
+        // Second child is peer1 / evaluator
+        sleep(3);
+        _exit(peer(1));
+    }
+
+    // Parent is the client
+    gash_config_init();
+    gash_ss_client_init();
+    client();
+
+    failed |= api_wait(p0);
+    failed |= api_wait(p1);
+    return failed;
+}
+
+#endif
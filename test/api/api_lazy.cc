@@ -0,0 +1,116 @@
+/*
+ * api_lazy.cc -- Lazy secdouble graph, one round per multiplicative depth
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_harness.hh"
+
+#define FIX(d) ((i64)((d) * (1 << CONFIG_S)))
+
+static const double in[] = { 0.25, 0.5, 0.5, -0.25 };
+
+/**
+ * Truncated product of two fixed point values
+ *
+ */
+static i64 fix_mul(i64 a, i64 b)
+{
+    return (i64)(((__int128)a * b) >> CONFIG_S);
+}
+
+/**
+ * The whole value, exact up to `tol` in the last bits. Each truncation is off
+ * by one at most, a product of truncated products below 1.0 by two more
+ *
+ */
+static bool near_fix(const mpz_class& got, i64 want, i64 tol)
+{
+    return got >= want - tol && got <= want + tol;
+}
+
+static int run_peer(int id)
+{
+    mpz_class share;
+    secdouble x[4];
+
+    api_peer_init(id);
+    for (int i = 0; i < 4; ++i) {
+        gash_ss_recv_share(share);
+        x[i] = secdouble(share);
+    }
+    gash_ss_share_triplet_slave();
+    gash_ring_share_trunc_pairs_slave();
+
+    // Two independent products, then one that needs both: two rounds
+    gash_ss_lazy_begin();
+    secdouble p = x[0] * x[1];
+    secdouble q = x[2] * x[3];
+    secdouble r = p * q + x[0];
+    secdouble s = p - q;
+    EXPECT_TRUE(r.m_node != NULL);
+    EXPECT_EQ(2, gash_ss_lazy_end());
+
+    // Reading a pending value runs the graph
+    gash_ss_lazy_begin();
+    secdouble t = x[1] * x[3] + x[2];
+    share = t.value();
+    EXPECT_EQ(0, gash_ss_lazy_end());
+    gash_ss_recon_slave(share);
+
+    // Nothing is left pending
+    EXPECT_EQ(0, gash_ss_lazy_flush());
+    share = s.value();
+    gash_ss_recon_slave(share);
+    share = r.value();
+    gash_ss_recon_slave(share);
+
+    return ::testing::Test::HasFailure();
+}
+
+TEST_F(APITest, LazySecdouble) {
+
+    int failed = api_run(run_peer, [] {
+        mpz_class y;
+
+        for (double d : in) {
+            mpz_class v = FIX(d);
+            gash_ss_send_share(v);
+        }
+        gash_ss_generate_triplet();
+        gash_ss_share_triplet_master();
+        gash_ring_share_trunc_pairs_master(4);
+
+        i64 p = fix_mul(FIX(in[0]), FIX(in[1]));
+        i64 q = fix_mul(FIX(in[2]), FIX(in[3]));
+
+        gash_ss_recon_master(y);
+        EXPECT_TRUE(near_fix(y, fix_mul(FIX(in[1]), FIX(in[3])) + FIX(in[2]), 1)) << y;
+        gash_ss_recon_master(y);
+        EXPECT_TRUE(near_fix(y, p - q, 2)) << y;
+
+        // The depth-2 result
+        gash_ss_recon_master(y);
+        EXPECT_TRUE(near_fix(y, fix_mul(p, q) + FIX(in[0]), 3)) << y;
+    });
+    EXPECT_EQ(0, failed);
+}
+
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
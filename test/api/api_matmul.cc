@@ -0,0 +1,112 @@
+/*
+ * api_matmul.cc -- Secret-shared matrix products with matrix triplets
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_harness.hh"
+
+#define FIX(d) ((ring_t)(i64)((d) * (1 << CONFIG_S)))
+
+// A is 2 x 3, B is 3 x 2, entries of both signs and products beyond 1.0
+static const double A[] = { 0.25, -0.5, 3.125,
+                            -7.5, 0.25, -0.25 };
+static const double B[] = { 0.5,  -0.25,
+                            6.25,  0.5,
+                            -0.5,  0.125 };
+
+/**
+ * Row i of A times column j of B, truncated once as the parties do
+ *
+ */
+static i64 fix_dot(u32 i, u32 j)
+{
+    __int128 sum = 0;
+    for (u32 l = 0; l < 3; ++l) {
+        sum += (__int128)(i64)FIX(A[i * 3 + l]) * (i64)FIX(B[l * 2 + j]);
+    }
+    return (i64)(sum >> CONFIG_S);
+}
+
+/**
+ * The whole ring value, exact up to the last bit
+ *
+ */
+static bool near_fix(i64 got, i64 want)
+{
+    return got >= want - 1 && got <= want + 1;
+}
+
+static int run_peer(int id)
+{
+    vector<ring_t> a, b;
+
+    api_peer_init(id);
+    gash_ring_share_mat_triplet_slave();
+    gash_ring_share_mat_triplet_slave();
+    gash_ring_share_trunc_pairs_slave();
+    gash_ring_recv_shares(a);
+    gash_ring_recv_shares(b);
+
+    secmat64 ma(2, 3, a);
+    secmat64 mb(3, 2, b);
+    secmat64 mc = ma * mb;
+    for (u32 i = 0; i < mc.m_v.size(); ++i) {
+        gash_ring_recon_slave(mc.m_v[i]);
+    }
+
+    // First row of A with the first column of B
+    secmat64 row(3, 1, vector<ring_t>(a.begin(), a.begin() + 3));
+    secmat64 col = mb.transpose();
+    col.m_v.resize(3);
+    secdouble64 dot = gash_ring_dot(row, col);
+    gash_ring_recon_slave(dot.m_v);
+    return 0;
+}
+
+TEST_F(APITest, SecMatMul) {
+
+    int failed = api_run(run_peer, [] {
+        vector<ring_t> a, b;
+        i64 y;
+
+        for (double d : A) a.push_back(FIX(d));
+        for (double d : B) b.push_back(FIX(d));
+
+        gash_ring_share_mat_triplet_master(2, 3, 2, 1);
+        gash_ring_share_mat_triplet_master(1, 3, 1, 1);
+        gash_ring_share_trunc_pairs_master(5);
+        gash_ring_send_shares(a);
+        gash_ring_send_shares(b);
+
+        for (u32 i = 0; i < 2; ++i) {
+            for (u32 j = 0; j < 2; ++j) {
+                gash_ring_recon_master(y);
+                EXPECT_TRUE(near_fix(y, fix_dot(i, j))) << i << "," << j << ": " << y;
+            }
+        }
+
+        gash_ring_recon_master(y);
+        EXPECT_TRUE(near_fix(y, fix_dot(0, 0))) << y;
+    });
+    EXPECT_EQ(0, failed);
+}
+
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,64 @@
+/*
+ * api_mul_dealer.cc -- Secure multiplication with triplets from the dealer
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_harness.hh"
+
+// More multiplications than the parties prefetch, so the dealer has to refill
+#define N_MUL (TRIPLET_DEALER_AHEAD + 2) * TRIPLET_BATCH_SZ
+
+static int run_peer(int id)
+{
+    ring_t a, b;
+    ring_t y = 0;
+
+    api_peer_init(id);
+    gash_triplet_party_init(c_ip);
+
+    gash_ring_recv_share(a);
+    gash_ring_recv_share(b);
+    for (int i = 0; i < N_MUL; ++i) {
+        y += gash_ring_mul(a, b);
+    }
+    gash_ring_recon_slave(y);
+
+    gash_triplet_dealer_close();
+    return 0;
+}
+
+TEST_F(APITest, SecMulDealer) {
+
+    // The client is also the dealer
+    int failed = api_run(run_peer, [] {
+        i64 y;
+
+        ASSERT_EQ(0, gash_triplet_dealer_init());
+        gash_ring_send_share((ring_t)-10000);
+        gash_ring_send_share(33);
+        gash_ring_recon_master(y);
+        EXPECT_EQ(-10000 * 33 * (i64)N_MUL, y);
+    });
+    EXPECT_EQ(0, failed);
+    gash_triplet_dealer_close();
+}
+
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
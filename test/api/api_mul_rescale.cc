@@ -0,0 +1,170 @@
+/*
+ * api_mul_rescale.cc -- Multiplication fused with an exact truncation
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_harness.hh"
+
+#define NMUL 128
+
+// Ring batch, secdouble64, the GMP batch and a fractional public factor,
+// one pair per product each
+#define NPAIR (4 * NMUL)
+
+// Public factors, the integer one needs no truncation
+#define KINT  (-3.0)
+#define KFRAC 0.75
+
+// secdouble products once the pairs ran out, rescaled by gash_ss_rescale_p2p
+#define NLATE 16
+
+static int run_peer(int id)
+{
+    vector<ring_t> x, y, z;
+    vector<mpz_class> xs, ys, zs;
+
+    api_peer_init(id);
+
+    gash_ring_share_triplet_slave();
+    gash_ss_share_triplet_slave();
+    gash_ring_share_trunc_pairs_slave();
+    gash_ring_recv_shares(x);
+    gash_ring_recv_shares(y);
+
+    z = gash_ring_mul_rescale_batch(x, y);
+    for (u32 i = 0; i < NMUL; ++i) {
+        gash_ring_recon_slave(z[i]);
+    }
+
+    for (u32 i = 0; i < NMUL; ++i) {
+        secdouble64 p = secdouble64(x[i]) * secdouble64(y[i]);
+        gash_ring_recon_slave(p.m_v);
+    }
+
+    for (u32 i = 0; i < NMUL; ++i) {
+        xs.push_back(mpz_class(x[i]));
+        ys.push_back(mpz_class(y[i]));
+    }
+    zs = gash_ss_mul_rescale_batch(xs, ys);
+    for (u32 i = 0; i < NMUL; ++i) {
+        gash_ss_recon_slave(zs[i]);
+    }
+
+    for (u32 i = 0; i < NMUL; ++i) {
+        secdouble64 p(x[i]);
+        double k = KINT;
+        p * k;
+        gash_ring_recon_slave(p.m_v);
+    }
+
+    for (u32 i = 0; i < NMUL; ++i) {
+        secdouble64 p(x[i]);
+        double k = KFRAC;
+        p * k;
+        gash_ring_recon_slave(p.m_v);
+    }
+
+    gash_ss_recv_shares(xs);
+    gash_ss_recv_shares(ys);
+    for (u32 i = 0; i < NLATE; ++i) {
+        secdouble p = secdouble(xs[i]) * secdouble(ys[i]);
+        gash_ss_recon_slave(p.m_mpz);
+    }
+    return 0;
+}
+
+TEST_F(APITest, MulRescale) {
+
+    int failed = api_run(run_peer, [] {
+        vector<ring_t> x, y;
+        vector<i64> want;
+        vector<i64> xv;
+        mpz_class v;
+        i64 got;
+
+        // Fixed point values of both signs up to 8.0, products up to 64.0
+        for (u32 i = 0; i < NMUL; ++i) {
+            i64 a = (i64)(random() % (1 << (CONFIG_S + 4))) - (1 << (CONFIG_S + 3));
+            i64 b = (i64)(random() % (1 << (CONFIG_S + 4))) - (1 << (CONFIG_S + 3));
+            xv.push_back(a);
+            x.push_back((ring_t)a);
+            y.push_back((ring_t)b);
+            want.push_back((i64)(((__int128)a * b) >> CONFIG_S));
+        }
+
+        gash_ring_generate_triplet();
+        gash_ring_share_triplet_master();
+        gash_ss_generate_triplet();
+        gash_ss_share_triplet_master();
+        gash_ring_share_trunc_pairs_master(NPAIR);
+        gash_ring_send_shares(x);
+        gash_ring_send_shares(y);
+
+        for (int pass = 0; pass < 2; ++pass) {
+            for (u32 i = 0; i < NMUL; ++i) {
+                gash_ring_recon_master(got);
+                EXPECT_TRUE(got >= want[i] - 1 && got <= want[i] + 1)
+                    << pass << ", " << i << ": " << got << " != " << want[i];
+            }
+        }
+
+        for (u32 i = 0; i < NMUL; ++i) {
+            gash_ss_recon_master(v);
+            EXPECT_TRUE(v >= want[i] - 1 && v <= want[i] + 1)
+                << i << ": " << v << " != " << want[i];
+        }
+
+        for (u32 i = 0; i < NMUL; ++i) {
+            gash_ring_recon_master(got);
+            EXPECT_EQ((i64)KINT * xv[i], got) << i;
+        }
+
+        for (u32 i = 0; i < NMUL; ++i) {
+            i64 w = (i64)std::floor(xv[i] * KFRAC);
+            gash_ring_recon_master(got);
+            EXPECT_TRUE(got >= w - 1 && got <= w + 1) << i << ": " << got << " != " << w;
+        }
+
+        // Positive values below 1.0, gash_ss_rescale_p2p keeps the low
+        // CONFIG_L_S bits of the result
+        vector<mpz_class> xl, yl;
+        vector<i64> wl;
+        for (u32 i = 0; i < NLATE; ++i) {
+            i64 a = random() % (1 << CONFIG_S);
+            i64 b = random() % (1 << CONFIG_S);
+            xl.push_back(mpz_class((long)a));
+            yl.push_back(mpz_class((long)b));
+            wl.push_back((a * b) >> CONFIG_S);
+        }
+        gash_ss_send_shares(xl);
+        gash_ss_send_shares(yl);
+
+        for (u32 i = 0; i < NLATE; ++i) {
+            i64 mask = ((i64)1 << CONFIG_L_S) - 1;
+            gash_ss_recon_master(v);
+            i64 d = (v.get_si() - wl[i]) & mask;
+            EXPECT_TRUE(d <= 1 || d == mask) << i << ": " << v << " != " << wl[i];
+        }
+    });
+    EXPECT_EQ(0, failed);
+}
+
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
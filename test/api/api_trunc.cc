@@ -0,0 +1,81 @@
+/*
+ * api_trunc.cc -- Batched probabilistic truncation with dealt pairs
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_harness.hh"
+
+#define NTRUNC 256
+
+static int run_peer(int id)
+{
+    vector<ring_t> x;
+
+    api_peer_init(id);
+
+    gash_ring_share_trunc_pairs_slave();
+    gash_ring_recv_shares(x);
+
+    // One pair short
+    vector<ring_t> more(NTRUNC + 1);
+    if (gash_ring_rescale_batch(more) != -G_EINVAL) {
+        return 1;
+    }
+
+    if (gash_ring_rescale_batch(x) != 0) {
+        return 1;
+    }
+    for (u32 i = 0; i < x.size(); ++i) {
+        gash_ring_recon_slave(x[i]);
+    }
+    return 0;
+}
+
+TEST_F(APITest, RescaleBatch) {
+
+    int failed = api_run(run_peer, [] {
+        vector<ring_t> x;
+        i64 y;
+        i64 want;
+
+        // Small values and values close to the bound of 2^(L - 2)
+        for (u32 i = 0; i < NTRUNC; ++i) {
+            i64 v = (i64)(random() % 2000000) - 1000000;
+            if (i % 4 == 3) {
+                v = v * ((i64)1 << 40);
+            }
+            x.push_back((ring_t)v);
+        }
+
+        gash_ring_share_trunc_pairs_master(NTRUNC);
+        gash_ring_send_shares(x);
+
+        for (u32 i = 0; i < NTRUNC; ++i) {
+            gash_ring_recon_master(y);
+            want = (i64)x[i] >> CONFIG_S;
+            EXPECT_TRUE(y == want || y == want + 1 || y == want - 1)
+                << (i64)x[i] << ": " << y << " != " << want;
+        }
+    });
+    EXPECT_EQ(0, failed);
+}
+
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
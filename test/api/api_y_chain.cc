@@ -0,0 +1,88 @@
+/*
+ * api_y_chain.cc -- Chained circuits on garbled shares within a session
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "api_harness.hh"
+
+static const i64 X[] = { 5, -7, (i64)1 << 40, -((i64)1 << 33), -3 };
+static const i64 Y[] = { 3, -9, (i64)1 << 41, 2, -3 };
+
+#define N (sizeof(X) / sizeof(X[0]))
+
+static int run_peer(int id)
+{
+    vector<ring_t> x, y;
+    vector<ring_t> out;
+    vector<ring_t> gt;
+
+    api_peer_init(id, true);
+
+    gash_ring_recv_shares(x);
+    gash_ring_recv_shares(y);
+
+    // relu(max(x, y)), comparison, mux and relu stay garbled
+    for (int round = 0; round < 2; ++round) {
+        gash_gc_session_begin();
+
+        vector<yshare_t> yx = gash_ring_a2y_batch(x);
+        vector<yshare_t> yy = gash_ring_a2y_batch(y);
+        vector<yshare_t> c = gash_y_gt_batch(yx, yy);
+        vector<yshare_t> m = gash_y_mux_batch(c, yx, yy);
+        vector<yshare_t> r = gash_y_relu_batch(m);
+
+        gt = gash_y_open_batch(c);
+        out = gash_ring_y2a_batch(r);
+
+        gash_gc_session_end();
+
+        for (u32 i = 0; i < N; ++i) {
+            if (c[i].size() != 1 || gt[i] != (ring_t)(X[i] > Y[i])) {
+                return 1;
+            }
+            gash_ring_recon_slave(out[i]);
+        }
+    }
+    return 0;
+}
+
+TEST_F(APITest, GarbledChain) {
+
+    int failed = api_run(run_peer, [] {
+        vector<ring_t> x(X, X + N), y(Y, Y + N);
+        i64 v;
+        i64 want;
+
+        gash_ring_send_shares(x);
+        gash_ring_send_shares(y);
+
+        for (int round = 0; round < 2; ++round) {
+            for (u32 i = 0; i < N; ++i) {
+                want = X[i] > Y[i] ? X[i] : Y[i];
+                gash_ring_recon_master(v);
+                EXPECT_EQ(want > 0 ? want : 0, v) << round << ", " << i;
+            }
+        }
+    });
+    EXPECT_EQ(0, failed);
+}
+
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
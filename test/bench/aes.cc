@@ -0,0 +1,151 @@
+/*
+ * aes.cc -- Microbenchmark for garbling with fixed-key AES
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include "../../include/common.hh"
+#include "../../gc/aes.hh"
+#include "../../gc/util.hh"
+
+#define NGATE 1000000
+
+/// Rows per buffer of bench_rows, small enough to stay in L1
+#define NROW 512
+
+using namespace gashgc;
+
+namespace gashgc {
+  extern block AESkey;
+}
+
+block g_sink;
+
+/**
+ * Garble NGATE AND gates (one implicit and three garbled rows each), with
+ * `enc` computing one row
+ *
+ * @return gates per second
+ */
+template <typename Enc>
+static double bench_garble(const LabelVec& lbls, block R, Enc enc)
+{
+    block ZERO = getZEROblock();
+    block acc = ZERO;
+    block a[2], b[2], tweak, out0;
+    u32 n = lbls.size();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (u32 g = 0; g < NGATE; g++) {
+        a[0] = lbls[g % n];
+        a[1] = xor_block(a[0], R);
+        b[0] = lbls[(g * 7 + 1) % n];
+        b[1] = xor_block(b[0], R);
+        tweak = new_tweak(g);
+
+        out0 = enc(a[0], b[0], tweak, ZERO);
+        for (int r = 1; r < 4; r++) {
+            acc = xor_block(acc, enc(a[r & 1], b[r >> 1], tweak, (r == 3) ? xor_block(out0, R) : out0));
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(end - start).count();
+
+    // Keep the result alive
+    g_sink = xor_block(g_sink, acc);
+
+    return NGATE / sec;
+}
+
+/**
+ * Encrypt the same NROW rows 4 * NGATE / NROW times, with one
+ * FixedKeyAES::encrypt call per row or with encrypt_n over all of them. Both
+ * read and write the same buffers, so the only difference is the interleaving
+ *
+ * @return rows per second
+ */
+static double bench_rows(const FixedKeyAES& aes, const block* a, const block* b, const block* T,
+                         block* out, bool interleaved)
+{
+    block ZERO = getZEROblock();
+    block acc = ZERO;
+    u32 reps = 4 * NGATE / NROW;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (u32 k = 0; k < reps; k++) {
+        if (interleaved) {
+            aes.encrypt_n(a, b, T, NULL, out, NROW);
+        } else {
+            for (u32 i = 0; i < NROW; i++) {
+                out[i] = aes.encrypt(a[i], b[i], T[i], ZERO);
+            }
+        }
+        acc = xor_block(acc, out[k % NROW]);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(end - start).count();
+
+    g_sink = xor_block(g_sink, acc);
+
+    return (double)reps * NROW / sec;
+}
+
+int main()
+{
+    LabelVec lbls;
+    block R;
+    FixedKeyAES aes;
+
+    srand_sse(time(NULL));
+    R = random_block();
+    set_lsb(R);
+    for (int i = 0; i < 1024; i++) {
+        lbls.emplace_back(random_block());
+    }
+
+    double per_call = bench_garble(lbls, R, [](block a, block b, block T, block c) {
+        return encrypt(a, b, T, c, AESkey);
+    });
+
+    double fixed_key = bench_garble(lbls, R, [&aes](block a, block b, block T, block c) {
+        return aes.encrypt(a, b, T, c);
+    });
+
+    vector<block> a(NROW), b(NROW), T(NROW), out(NROW);
+    for (u32 i = 0; i < NROW; i++) {
+        a[i] = lbls[i];
+        b[i] = lbls[(i * 7 + 1) % lbls.size()];
+        T[i] = new_tweak(i / 4);
+    }
+    double sequential = bench_rows(aes, a.data(), b.data(), T.data(), out.data(), false);
+    double interleaved = bench_rows(aes, a.data(), b.data(), T.data(), out.data(), true);
+
+    cout << "AND gates garbled per second" << endl;
+    cout << "  key expansion per call: " << per_call << endl;
+    cout << "  fixed-key AES:          " << fixed_key << endl;
+    cout << "  speedup:                " << fixed_key / per_call << "x" << endl;
+    cout << "Garbled rows per second, " << NROW << " rows" << endl;
+    cout << "  encrypt per row:        " << sequential << endl;
+    cout << "  encrypt_n, " << AES_BATCH_SZ << " in flight: " << interleaved << endl;
+    cout << "  speedup:                " << interleaved / sequential << "x" << endl;
+
+    return 0;
+}
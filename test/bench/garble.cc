@@ -0,0 +1,136 @@
+/*
+ * garble.cc -- Garbling throughput on a synthetic circuit
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include "../../include/common.hh"
+#include "../../gc/garbler.hh"
+
+#define NIN 256
+#define NGATE 1000000
+#define WINDOW 4096     // Gate inputs are drawn from the last WINDOW wires
+
+using namespace gashgc;
+
+struct SynGate {
+    u32 out, in0, in1;
+    int func;
+};
+
+/**
+ * A random circuit with roughly 2/3 AND and 1/3 XOR gates, wire i + 1 is the
+ * output of gate i - NIN
+ *
+ */
+static void gen_circuit(vector<SynGate>& gates)
+{
+    srandom(1);
+    for (u32 g = 0; g < NGATE; g++) {
+        u32 out = NIN + 1 + g;
+        u32 lo = out > WINDOW ? out - WINDOW : 1;
+        SynGate sg;
+        sg.out = out;
+        sg.in0 = lo + random() % (out - lo);
+        sg.in1 = lo + random() % (out - lo);
+        sg.func = random() % 3 == 0 ? funcXOR : funcAND;
+        gates.emplace_back(sg);
+    }
+}
+
+static double secs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Garble the flat version of `gates`
+ *
+ * @return Gates garbled per second
+ */
+static double flat_rate(vector<SynGate>& gates, int scheme, u32 nthread)
+{
+    Garbler garbler;
+    garbler.m_listen_sock = garbler.m_peer_sock = -1;
+    garbler.m_scheme = scheme;
+    garbler.m_nthread = nthread;
+    FlatCircuit& c = garbler.m_fc;
+    for (u32 i = 1; i <= NIN; i++) {
+        c.m_in_idx.emplace_back(c.add_wire(i));
+        c.m_in_id_set.emplace(i);
+    }
+    for (auto& g : gates) {
+        u32 in0 = c.add_wire(g.in0);
+        u32 in1 = c.add_wire(g.in1);
+        c.add_gate(c.add_wire(g.out), g.func, in0, in1);
+    }
+    c.levelize();
+
+    auto start = std::chrono::steady_clock::now();
+    garbler.garble_circ();
+    return NGATE / secs(start);
+}
+
+int main()
+{
+    vector<SynGate> gates;
+    gen_circuit(gates);
+
+    // Legacy map-based circuit
+    double legacy;
+    {
+        Garbler garbler;
+        garbler.m_listen_sock = garbler.m_peer_sock = -1;
+        garbler.m_flat = false;
+        Circuit& c = garbler.m_c;
+        for (u32 i = 1; i <= NIN; i++) {
+            c.add_wireins(new WI(i, false));
+            c.m_in_id_set.emplace(i);
+        }
+        for (auto& g : gates) {
+            c.create_gate(g.out, g.func, g.in0, g.in1, false, false);
+        }
+        c.m_ngate = c.m_gate_map.size();
+
+        auto start = std::chrono::steady_clock::now();
+        garbler.garble_circ();
+        legacy = NGATE / secs(start);
+    }
+
+    // Flat circuit, with each garbling scheme
+    double flat[2];
+    for (int scheme = GC_GRR3; scheme <= GC_HALF_GATES; scheme++) {
+        flat[scheme] = flat_rate(gates, scheme, 1);
+    }
+
+    // Half gates, with the gates of every level split across threads
+    u32 nthreads[] = {1, 2, 4, 8, 16, 32};
+    vector<double> threaded;
+    for (u32 nthread : nthreads) {
+        threaded.push_back(flat_rate(gates, GC_HALF_GATES, nthread));
+    }
+
+    cout << "Gates garbled per second (" << NGATE << " gates, 2/3 AND)" << endl;
+    cout << "  Circuit:                 " << legacy << endl;
+    cout << "  FlatCircuit, GRR3:       " << flat[GC_GRR3] << endl;
+    cout << "  FlatCircuit, half gates: " << flat[GC_HALF_GATES] << endl;
+    for (size_t i = 0; i < threaded.size(); i++) {
+        cout << "  FlatCircuit, half gates, " << nthreads[i] << " threads: " << threaded[i] << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * ot.cc -- Benchmark OT extension of evaluator input labels
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <sys/wait.h>
+#include "../../include/common.hh"
+#include "../../gc/ot.hh"
+#include "../../gc/util.hh"
+
+#define NLBL (1 << 22)
+#define PORT 49900
+
+using namespace gashgc;
+
+static double secs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Transfer NLBL labels on `nthread` threads, the base OTs are run before the
+ * clock starts
+ *
+ * @return Labels transferred per second, as seen by the sender
+ */
+static double ot_rate(LabelVec& lbl0s, LabelVec& lbl1s, vector<u8>& sel, u32 nthread, int port)
+{
+    LabelVec warm(1);
+
+    if (fork() == 0) {
+        usleep(100000);
+        OTParty otp;
+        otp.m_nNumOTThreads = nthread;
+        otp.OTRecv("127.0.0.1", port, vector<u8>(1), [](u32, const block*, u32) {});
+        otp.OTRecv("127.0.0.1", port, sel, [](u32, const block*, u32) {});
+        _exit(0);
+    }
+
+    OTParty otp;
+    otp.m_nNumOTThreads = nthread;
+    otp.OTSend("127.0.0.1", port, warm, warm);
+
+    auto start = std::chrono::steady_clock::now();
+    otp.OTSend("127.0.0.1", port, lbl0s, lbl1s);
+    double rate = NLBL / secs(start);
+
+    wait(NULL);
+    return rate;
+}
+
+int main()
+{
+    LabelVec lbl0s;
+    LabelVec lbl1s;
+    vector<u8> sel;
+
+    for (u32 i = 0; i < NLBL; i++) {
+        lbl0s.emplace_back(random_block());
+        lbl1s.emplace_back(random_block());
+        sel.emplace_back(rand() % 2);
+    }
+
+    u32 nthreads[] = {1, 2, 4, 8, 16};
+    vector<double> rates;
+    for (u32 i = 0; i < sizeof(nthreads) / sizeof(u32); i++) {
+        rates.push_back(ot_rate(lbl0s, lbl1s, sel, nthreads[i], PORT + i));
+    }
+
+    cout << "Labels transferred per second (" << NLBL << " labels, " << OT_CHUNK << " per chunk)" << endl;
+    for (size_t i = 0; i < rates.size(); i++) {
+        cout << "  " << nthreads[i] << " threads: " << rates[i] << endl;
+    }
+
+    return 0;
+}
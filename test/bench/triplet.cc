@@ -0,0 +1,149 @@
+/*
+ * triplet.cc -- Benchmark Beaver triplets from the dealer against OT triplets
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <sys/wait.h>
+#include "../../api/gash.hh"
+
+#define NTRI 100000
+#define IP "127.0.0.1"
+
+static double secs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Bytes sent over loopback so far, every party of the benchmark runs on it
+ *
+ * @return
+ */
+static u64 lo_bytes()
+{
+    std::ifstream dev("/proc/net/dev");
+    string line;
+    u64 rx, tx;
+    char rest[256];
+
+    while (std::getline(dev, line)) {
+        if (sscanf(line.c_str(), " lo: %llu %*u %*u %*u %*u %*u %*u %*u %llu %255[^\n]",
+                   (unsigned long long*)&rx, (unsigned long long*)&tx, rest) >= 2) {
+            return tx;
+        }
+    }
+    return 0;
+}
+
+static void init_peer(int id)
+{
+    gash_config_init();
+    if (id == 0) {
+        gash_init_as_garbler(IP);
+    } else {
+        usleep(100000);
+        gash_init_as_evaluator(IP);
+    }
+}
+
+/**
+ * NTRI triplets drawn from the dealer by both parties
+ *
+ * @return Triplets per second, as seen by party 0
+ */
+static double dealer_rate(u64& bytes)
+{
+    int fd[2];
+    double rate = 0;
+    u64 start_bytes = lo_bytes();
+
+    pipe(fd);
+    for (int id = 0; id < 2; ++id) {
+        if (fork() == 0) {
+            init_peer(id);
+            gash_triplet_party_init(IP);
+
+            auto start = std::chrono::steady_clock::now();
+            for (u32 i = 0; i < NTRI; ++i) {
+                gash_ring_get_next_triplet();
+            }
+            rate = NTRI / secs(start);
+
+            if (id == 0) {
+                write(fd[1], &rate, sizeof(rate));
+            }
+            gash_triplet_dealer_close();
+            _exit(0);
+        }
+    }
+
+    gash_triplet_dealer_init();
+    read(fd[0], &rate, sizeof(rate));
+    wait(NULL);
+    wait(NULL);
+    gash_triplet_dealer_close();
+
+    bytes = lo_bytes() - start_bytes;
+    return rate;
+}
+
+/**
+ * NTRI triplets from OT between the two parties, the base OTs are run before
+ * the clock starts
+ *
+ * @return Triplets per second, as seen by party 0
+ */
+static double ot_rate(u64& bytes)
+{
+    double rate;
+    u64 start_bytes;
+
+    if (fork() == 0) {
+        init_peer(1);
+        gash_ring_generate_triplet_ot(1);
+        gash_ring_generate_triplet_ot(NTRI);
+        _exit(0);
+    }
+
+    init_peer(0);
+    gash_ring_generate_triplet_ot(1);
+
+    start_bytes = lo_bytes();
+    auto start = std::chrono::steady_clock::now();
+    gash_ring_generate_triplet_ot(NTRI);
+    rate = NTRI / secs(start);
+
+    wait(NULL);
+    bytes = lo_bytes() - start_bytes;
+    return rate;
+}
+
+int main()
+{
+    u64 dealer_bytes;
+    u64 ot_bytes;
+    double dealer = dealer_rate(dealer_bytes);
+    double ot = ot_rate(ot_bytes);
+
+    cout << "Triplets per second and bytes per triplet (" << NTRI << " triplets)" << endl;
+    cout << "  dealer: " << dealer << ", " << (double)dealer_bytes / NTRI << endl;
+    cout << "  OT:     " << ot << ", " << (double)ot_bytes / NTRI << endl;
+
+    return 0;
+}
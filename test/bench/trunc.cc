@@ -0,0 +1,142 @@
+/*
+ * trunc.cc -- Benchmark batched truncation and its error against CONFIG_S
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <random>
+#include <sys/wait.h>
+#include "../../api/gash.hh"
+
+#define NTRUNC 100000
+#define NSIM   1000000
+#define IP "127.0.0.1"
+
+static double secs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void init_peer(int id)
+{
+    gash_config_init();
+    if (id == 0) {
+        gash_init_as_garbler(IP);
+        gash_ss_garbler_init(IP);
+    } else {
+        usleep(100000);
+        gash_init_as_evaluator(IP);
+        gash_ss_evaluator_init(IP, IP);
+    }
+}
+
+/**
+ * NTRUNC shares rescaled in one batch, the pairs are dealt before the clock
+ * starts
+ *
+ * @return Truncations per second, as seen by party 0
+ */
+static double batch_rate()
+{
+    int fd[2];
+    double rate = 0;
+
+    pipe(fd);
+    for (int id = 0; id < 2; ++id) {
+        if (fork() == 0) {
+            vector<ring_t> x(NTRUNC, 0);
+
+            init_peer(id);
+            gash_ring_share_trunc_pairs_slave();
+
+            auto start = std::chrono::steady_clock::now();
+            gash_ring_rescale_batch(x);
+            rate = NTRUNC / secs(start);
+
+            if (id == 0) {
+                write(fd[1], &rate, sizeof(rate));
+            }
+            _exit(0);
+        }
+    }
+
+    gash_config_init();
+    gash_ss_client_init();
+    gash_ring_share_trunc_pairs_master(NTRUNC);
+    read(fd[0], &rate, sizeof(rate));
+    wait(NULL);
+    wait(NULL);
+
+    return rate;
+}
+
+/**
+ * Run the share arithmetic of both parties locally on random x with
+ * |x| < 2^bits and count the results that are off
+ *
+ * @param s Fractional bits to drop
+ * @param bits
+ * @param lsb Results off by one
+ * @param big Results off by more
+ */
+static void simulate(u32 s, u32 bits, u64& lsb, u64& big)
+{
+    std::mt19937_64 gen(s);
+    ring_t half = ((ring_t)1 << (CONFIG_L - 1)) - 1;
+    ring_t x, r, rh0, rb0, c, y;
+    i64 err;
+
+    lsb = big = 0;
+    for (u32 i = 0; i < NSIM; ++i) {
+        x = (gen() >> (CONFIG_L - 1 - bits)) - ((ring_t)1 << bits);
+        r = gen();
+        rh0 = gen();
+        rb0 = gen();
+        c = x + ((ring_t)1 << (CONFIG_L - 2)) + r;
+
+        y = ring_trunc_share(0, c, rh0, rb0, s) +
+            ring_trunc_share(1, c, ((r & half) >> s) - rh0, (r >> (CONFIG_L - 1)) - rb0, s);
+        err = (i64)(y - (ring_t)((i64)x >> s));
+
+        if (err == 1 || err == -1) {
+            lsb++;
+        } else if (err != 0) {
+            big++;
+        }
+    }
+}
+
+int main()
+{
+    u32 scales[] = { 8, 12, 16, CONFIG_S, 24, 32 };
+    u32 ranges[] = { 40, CONFIG_L - 2, CONFIG_L - 1 };
+    u64 lsb, big;
+
+    cout << "Truncations per second (" << NTRUNC << " in one batch, CONFIG_S = "
+         << CONFIG_S << "): " << batch_rate() << endl;
+
+    cout << "Error rates over " << NSIM << " random x, off by one / off by more" << endl;
+    for (u32 bits : ranges) {
+        for (u32 s : scales) {
+            simulate(s, bits, lsb, big);
+            cout << "  |x| < 2^" << bits << ", s = " << s << ": "
+                 << (double)lsb / NSIM << " / " << (double)big / NSIM << endl;
+        }
+    }
+
+    return 0;
+}
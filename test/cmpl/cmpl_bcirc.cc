@@ -0,0 +1,128 @@
+/*
+ * cmpl_bcirc.cc -- Unit testing binary circuit output
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../include/common.hh"
+#include "../../include/bcirc.hh"
+
+using gashgc::build_circuit;
+using gashgc::is_bcirc;
+
+static const char* add_src = "func add(int32 a, int32 b) {    "
+                             "    return a + b;               "
+                             "}                               "
+                             "#definput     a    0            "
+                             "#definput     b    1            ";
+
+/**
+ * Compile add_src to circ_fpath
+ *
+ */
+static int compile_add(const char* circ_fpath, const char* data_fpath, bool binary)
+{
+    extern FILE* yyin;
+    ofstream circ_stream(circ_fpath, std::ios::out | std::ios::trunc | std::ios::binary);
+    ofstream data_stream(data_fpath, std::ios::out | std::ios::trunc);
+
+    gashlang::parse_clean();
+    yyin = std::tmpfile();
+    std::fputs(add_src, yyin);
+    std::rewind(yyin);
+    gashlang::set_ofstream(circ_stream, data_stream);
+    gashlang::set_binary_circuit(binary);
+
+    return yyparse();
+}
+
+TEST_F(CMPLTest, BinaryCircuitMatchesText)
+{
+    FlatCircuit text;
+    FlatCircuit binary;
+
+    ASSERT_EQ(0, compile_add("add32.circ", "add32.dat", false));
+    ASSERT_EQ(0, compile_add("add32.bcirc", "add32b.dat", true));
+
+    EXPECT_FALSE(is_bcirc("add32.circ"));
+    EXPECT_TRUE(is_bcirc("add32.bcirc"));
+
+    ASSERT_EQ(0, build_circuit("add32.circ", text));
+    ASSERT_EQ(0, build_circuit("add32.bcirc", binary));
+
+    EXPECT_EQ(text.m_nin, binary.m_nin);
+    EXPECT_EQ(text.m_nout, binary.m_nout);
+    EXPECT_EQ(text.m_nwire, binary.m_nwire);
+    EXPECT_EQ(text.m_nlevel, binary.m_nlevel);
+    EXPECT_EQ(text.m_in0, binary.m_in0);
+    EXPECT_EQ(text.m_in1, binary.m_in1);
+    EXPECT_EQ(text.m_out, binary.m_out);
+    EXPECT_EQ(text.m_func, binary.m_func);
+    EXPECT_EQ(text.m_inv, binary.m_inv);
+    EXPECT_EQ(text.m_in_idx, binary.m_in_idx);
+    EXPECT_EQ(text.m_out_const_map.size(), binary.m_out_const_map.size());
+
+    // Wire ids keep counting across compilations, the second copy is shifted
+    ASSERT_EQ(text.m_wire_id.size(), binary.m_wire_id.size());
+    ASSERT_EQ(text.m_out_id_vec.size(), binary.m_out_id_vec.size());
+    u32 shift = binary.m_wire_id[0] - text.m_wire_id[0];
+    for (u32 i = 0; i < text.m_wire_id.size(); i++) {
+        EXPECT_EQ(text.m_wire_id[i] + shift, binary.m_wire_id[i]);
+    }
+    for (u32 i = 0; i < text.m_out_id_vec.size(); i++) {
+        EXPECT_EQ(text.m_out_id_vec[i] + shift, binary.m_out_id_vec[i]);
+    }
+}
+
+TEST_F(CMPLTest, BinaryCircuitChecksum)
+{
+    FlatCircuit circ;
+    char c;
+
+    ASSERT_EQ(0, compile_add("add32c.bcirc", "add32c.dat", true));
+
+    // Flip a bit of the last gate record
+    std::fstream file("add32c.bcirc", std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(-(int)(sizeof(u64) + sizeof(u32)), std::ios::end);
+    file.get(c);
+    file.seekp(-(int)(sizeof(u64) + sizeof(u32)), std::ios::end);
+    file.put(c ^ 2);
+    file.close();
+
+    EXPECT_EQ(-G_EINVAL, build_circuit("add32c.bcirc", circ));
+}
+
+TEST_F(CMPLTest, BinaryCircuitBadCounts)
+{
+    FlatCircuit circ;
+    u32 ngate = 0x40000000;
+
+    ASSERT_EQ(0, compile_add("add32d.bcirc", "add32d.dat", true));
+
+    // A gate count that runs far past the end of the file
+    std::fstream file("add32d.bcirc", std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offsetof(BcircHeader, m_ngate));
+    file.write((const char*)&ngate, sizeof(ngate));
+    file.close();
+
+    EXPECT_EQ(-G_EINVAL, build_circuit("add32d.bcirc", circ));
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
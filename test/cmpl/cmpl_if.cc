@@ -0,0 +1,163 @@
+/*
+ * cmpl_if.cc -- Unit testing if/else lowering
+ *
+ * Author: Xiaoting Tang <tang_xiaoting@brown.edu>
+ * Copyright: Xiaoting Tang (2018)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../include/common.hh"
+
+using gashgc::build_circuit;
+
+/**
+ * Compile src to circ_fpath and load it
+ *
+ */
+static int compile_flat(const char* src, const char* circ_fpath, FlatCircuit& circ)
+{
+    extern FILE* yyin;
+    ofstream circ_stream(circ_fpath, std::ios::out | std::ios::trunc);
+    ofstream data_stream("if.dat", std::ios::out | std::ios::trunc);
+
+    gashlang::parse_clean();
+    yyin = std::tmpfile();
+    std::fputs(src, yyin);
+    std::rewind(yyin);
+    gashlang::set_ofstream(circ_stream, data_stream);
+
+    REQUIRE_GOOD_STATUS(yyparse());
+    circ_stream.close();
+    data_stream.close();
+
+    return build_circuit(circ_fpath, circ);
+}
+
+/**
+ * Evaluate circ in the clear on the inputs of if.dat, the same way the
+ * garbler treats inverted wires
+ *
+ * @return The outputs, least significant bit first
+ */
+static u64 eval_flat(FlatCircuit& circ)
+{
+    ifstream file("if.dat");
+    string line;
+    vector<string> items;
+    map<u32, u32> in_val;
+    vector<u8> val(circ.m_nwire, 0);
+    u64 ret = 0;
+
+    while (getline(file, line)) {
+        items.clear();
+        gashgc::split(line, " ", items);
+        if (items.size() == 2 && items[0] != "input") {
+            in_val[stoi(items[0]) / 2] = stoi(items[1]);
+        }
+    }
+
+    for (u32 idx : circ.m_in_idx) {
+        val[idx] = in_val[circ.m_wire_id[idx]] ^ circ.get_inv(idx);
+    }
+
+    for (u32 g = 0; g < circ.m_ngate; g++) {
+        u32 in0 = circ.m_in0[g];
+        u32 in1 = circ.m_in1[g];
+        if (circ.m_func[g] == funcXOR) {
+            val[circ.m_out[g]] = val[in0] ^ val[in1];
+        } else {
+            val[circ.m_out[g]] = gashgc::eval_bgate(val[in0] ^ circ.get_inv(in0), val[in1] ^ circ.get_inv(in1), circ.m_func[g]);
+        }
+    }
+
+    for (u32 i = 0; i < circ.m_out_id_vec.size(); i++) {
+        u32 id = circ.m_out_id_vec[i];
+        auto it = circ.m_out_const_map.find(id);
+        u32 idx = circ.get_idx(id);
+        u64 bit = it != circ.m_out_const_map.end() ? it->second : val[idx] ^ circ.get_inv(idx);
+        ret |= bit << i;
+    }
+
+    return ret;
+}
+
+static const char* la_src = "func la(int16 a, int16 b) {         "
+                            "    int1 ret = 0;                   "
+                            "    if (a > b) { ret = 1; }         "
+                            "    return ret;                     "
+                            "}                                   ";
+
+static const char* max_src = "func max(int16 a, int16 b) {        "
+                             "    int16 ret = 0;                  "
+                             "    if (a > b) { ret = a; }         "
+                             "    else { ret = b; }               "
+                             "    return ret;                     "
+                             "}                                   ";
+
+TEST_F(CMPLTest, IF_ELSE_16)
+{
+    FlatCircuit la;
+    FlatCircuit max;
+
+    // A constant select lowers to the condition itself
+    ASSERT_EQ(0, compile_flat((string(la_src) + "#definput a 3 #definput b 5").c_str(), "la16.circ", la));
+    ASSERT_EQ(0, compile_flat((string(max_src) + "#definput a 3 #definput b 5").c_str(), "max16.circ", max));
+
+    // Selecting 16 bits costs one garbled gate per bit on top of the comparison
+    EXPECT_EQ(la.m_nnonxor + 16, max.m_nnonxor);
+}
+
+TEST_F(CMPLTest, IF_ELSE_16_EVAL)
+{
+    FlatCircuit la_f;
+    FlatCircuit la_t;
+    FlatCircuit max_f;
+    FlatCircuit max_t;
+
+    // Both values of the condition, each arm of the mux is taken once
+    ASSERT_EQ(0, compile_flat((string(la_src) + "#definput a 3 #definput b 5").c_str(), "la16f.circ", la_f));
+    EXPECT_EQ(0u, eval_flat(la_f));
+
+    ASSERT_EQ(0, compile_flat((string(la_src) + "#definput a 9 #definput b 5").c_str(), "la16t.circ", la_t));
+    EXPECT_EQ(1u, eval_flat(la_t));
+
+    ASSERT_EQ(0, compile_flat((string(max_src) + "#definput a 3 #definput b 1234").c_str(), "max16f.circ", max_f));
+    EXPECT_EQ(1234u, eval_flat(max_f));
+
+    ASSERT_EQ(0, compile_flat((string(max_src) + "#definput a 4321 #definput b 5").c_str(), "max16t.circ", max_t));
+    EXPECT_EQ(4321u, eval_flat(max_t));
+}
+
+TEST_F(CMPLTest, LA_16_SIGNED)
+{
+    // Two's complement order, including pairs that are both negative
+    static const int cases[][3] = {
+        { -7, -9, 1 }, { -9, -7, 0 }, { -1, 1, 0 }, { 1, -1, 1 }, { -5, -5, 0 },
+    };
+
+    for (u32 i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        FlatCircuit la;
+        string src = string(la_src) + "#definput a " + to_string(cases[i][0]) +
+                     " #definput b " + to_string(cases[i][1]);
+
+        ASSERT_EQ(0, compile_flat(src.c_str(), "la16s.circ", la));
+        EXPECT_EQ((u32)cases[i][2], eval_flat(la)) << cases[i][0] << " > " << cases[i][1];
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
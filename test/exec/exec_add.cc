@@ -29,6 +29,34 @@
 #define port           7798
 #define ot_port        43667
 
+TEST_F(EXECTest, Add64CotAfterGarble)
+{
+
+    m_circ_stream = ofstream("addc_g.circ", std::ios::out | std::ios::trunc);
+    m_data_stream = ofstream("addc_g.dat", std::ios::out | std::ios::trunc);
+    extern FILE* yyin;
+    const char* src = "func add(int64 a, int64 b) {       "
+                      "    return a + b;                  "
+                      "}                                  "
+                      "#definput     b    13              ";
+    yyin = std::tmpfile();
+    std::fputs(src, yyin);
+    std::rewind(yyin);
+    gashlang::set_ofstream(m_circ_stream, m_data_stream);
+    ASSERT_EQ(0, yyparse());
+    m_circ_stream.close();
+    m_data_stream.close();
+
+    // Runs before any test forks. The correlated OT would replace the labels
+    // the tables are already garbled with
+    Garbler garbler(e_ip, port + 6, ot_port + 6, "addc_g.circ", "addc_g.dat");
+    garbler.m_cot = true;
+    ASSERT_EQ(0, garbler.build_circ());
+    ASSERT_EQ(0, garbler.read_input());
+    ASSERT_EQ(0, garbler.garble_circ());
+    EXPECT_EQ(-G_EINVAL, garbler.send_peer_lbls());
+}
+
 TEST_F(EXECTest, Add64)
 {
 
@@ -58,6 +86,46 @@ TEST_F(EXECTest, Add64)
 
 }
 
+TEST_F(EXECTest, Add64Stream)
+{
+
+    gashgc::Timer timer;
+    exec_stream_test(g_ip,     e_ip,   g_circ, g_dat,
+            e_circ,   e_dat,  port + 2,   ot_port + 2,
+            "func add(int64 a, int64 b) {       "
+            "    return a + b;                  "
+            "}                                  ",
+            "#definput     b    13              ",
+            "#definput     a    14              ");
+
+    mpz_class output;
+    mpz_set_str(output.get_mpz_t(), output_str.c_str(), 2);
+
+    if (role == 1) {
+        EXPECT_EQ(27, output.get_si());
+    }
+}
+
+TEST_F(EXECTest, Add64Cot)
+{
+
+    gashgc::Timer timer;
+    exec_cot_test(g_ip,     e_ip,   g_circ, g_dat,
+            e_circ,   e_dat,  port + 4,   ot_port + 4,
+            "func add(int64 a, int64 b) {       "
+            "    return a + b;                  "
+            "}                                  ",
+            "#definput     b    13              ",
+            "#definput     a    14              ");
+
+    mpz_class output;
+    mpz_set_str(output.get_mpz_t(), output_str.c_str(), 2);
+
+    if (role == 1) {
+        EXPECT_EQ(27, output.get_si());
+    }
+}
+
 int main(int argc, char* argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
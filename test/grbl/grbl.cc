@@ -70,6 +70,49 @@ TEST_F(GRBLTest, CorrectDecryption)
     }
 }
 
+TEST_F(GRBLTest, FixedKeyAESMatchesEncrypt)
+{
+    FixedKeyAES aes;
+    block a = random_block();
+    block b = random_block();
+    block c = random_block();
+    block tweak;
+
+    for (int i = 0; i < NTEST; ++i) {
+        tweak = new_tweak(i);
+        EXPECT_EQ(1, block_eq(aes.encrypt(a, b, tweak, c), encrypt(a, b, tweak, c, AESkey)));
+        EXPECT_EQ(1, block_eq(aes.decrypt(a, b, tweak, c), decrypt(a, b, tweak, c, AESkey)));
+    }
+}
+
+TEST_F(GRBLTest, EncryptNMatchesEncrypt)
+{
+    FixedKeyAES aes;
+    block a[2 * AES_BATCH_SZ + 1];
+    block b[2 * AES_BATCH_SZ + 1];
+    block t[2 * AES_BATCH_SZ + 1];
+    block c[2 * AES_BATCH_SZ + 1];
+    block out[2 * AES_BATCH_SZ + 1];
+
+    for (u32 i = 0; i < 2 * AES_BATCH_SZ + 1; ++i) {
+        a[i] = random_block();
+        b[i] = random_block();
+        t[i] = new_tweak(i);
+        c[i] = random_block();
+    }
+
+    for (u32 n = 1; n <= 2 * AES_BATCH_SZ + 1; ++n) {
+        aes.encrypt_n(a, b, t, c, out, n);
+        for (u32 i = 0; i < n; ++i) {
+            EXPECT_EQ(1, block_eq(out[i], encrypt(a[i], b[i], t[i], c[i], AESkey)));
+        }
+        aes.decrypt_n(a, b, t, out, out, n);
+        for (u32 i = 0; i < n; ++i) {
+            EXPECT_EQ(1, block_eq(out[i], c[i]));
+        }
+    }
+}
+
 TEST_F(GRBLTest, CorrectEGTTDecryption)
 {
 
@@ -922,6 +965,271 @@ TEST_F(GRBLTest, CorrectADD) {
         }
     }
 
+/**
+ * Garble the flat circuit `c` with `scheme`, evaluate it on the raw input
+ * values in `raw` and check the label of every gate output against the
+ * garbler's labels. A non-XOR gate sees its inputs through their inversion
+ * bits, an XOR gate does not.
+ *
+ * @param c
+ * @param raw Raw value of every dense wire index, only inputs need to be set
+ * @param scheme
+ */
+static void check_flat_gc(FlatCircuit& c, vector<int>& raw, int scheme, u32 nthread = 1)
+{
+    Garbler garbler;
+    Evaluator evaluator;
+    block lbl;
+
+    garbler.m_listen_sock = garbler.m_peer_sock = -1;
+    evaluator.m_peer_sock = -1;
+
+    garbler.m_fc = c;
+    garbler.m_scheme = scheme;
+    garbler.m_nthread = nthread;
+    garbler.garble_flat_circ();
+
+    evaluator.m_fc = c;
+    evaluator.m_scheme = scheme;
+    evaluator.m_nthread = nthread;
+    evaluator.build_garbled_circuit();
+    evaluator.m_fgc.m_tbl = garbler.m_fgc.m_tbl;
+
+    /// Mimic oblivious transfer
+    for (u32 idx : c.m_in_idx) {
+        garbler.m_fgc.get_lbl(c, c.m_wire_id[idx], raw[idx], lbl);
+        evaluator.m_fgc.set_gwl(c, c.m_wire_id[idx], lbl);
+    }
+
+    evaluator.evaluate_flat_circ();
+
+    for (u32 g = 0; g < c.m_ngate; g++) {
+        if (c.m_func[g] == funcXOR) {
+            raw[c.m_out[g]] = raw[c.m_in0[g]] ^ raw[c.m_in1[g]];
+        } else {
+            raw[c.m_out[g]] = eval_bgate(raw[c.m_in0[g]] ^ c.get_inv(c.m_in0[g]),
+                                         raw[c.m_in1[g]] ^ c.get_inv(c.m_in1[g]),
+                                         c.m_func[g]);
+        }
+
+        u32 id = c.m_wire_id[c.m_out[g]];
+        garbler.m_fgc.get_lbl(c, id, raw[c.m_out[g]], lbl);
+        EXPECT_EQ(1, block_eq(lbl, evaluator.m_fgc.m_lbl[c.m_out[g]]));
+        if (block_eq(lbl, evaluator.m_fgc.m_lbl[c.m_out[g]]) != 1) {
+            cout << "scheme:" << scheme << endl;
+            cout << "func:" << (int)c.m_func[g] << endl;
+            cout << "out id:" << id << endl;
+        }
+    }
+
+    EXPECT_EQ(garbler.m_fgc.m_nrow * c.m_nnonxor, garbler.m_fgc.m_tbl.size());
+}
+
+TEST_F(GRBLTest, SplitBgate)
+{
+    int alpha, beta, gamma;
+
+    for (int func = 0; func < 16; ++func) {
+        int and_like = split_bgate(func, alpha, beta, gamma);
+        for (int a = 0; a < 2; ++a) {
+            for (int b = 0; b < 2; ++b) {
+                u32 expected = and_like ? ((a ^ alpha) & (b ^ beta)) ^ gamma
+                                        : gamma ^ (alpha & a) ^ (beta & b);
+                EXPECT_EQ(expected, eval_bgate(a, b, func));
+            }
+        }
+    }
+}
+
+TEST_F(GRBLTest, CorrectHalfGatesDecryption)
+{
+    int schemes[] = {GC_GRR3, GC_HALF_GATES};
+
+    for (int scheme : schemes) {
+        for (int func = 0; func < 16; ++func) {
+            for (int in0val = 0; in0val < 2; in0val++) {
+                for (int in1val = 0; in1val < 2; in1val++) {
+                    for (int in0inv = 0; in0inv < 2; in0inv++) {
+                        for (int in1inv = 0; in1inv < 2; in1inv++) {
+
+                            FlatCircuit c;
+                            u32 in0 = c.add_wire(100);
+                            u32 in1 = c.add_wire(101);
+                            c.m_in_idx = {in0, in1};
+                            c.add_gate(c.add_wire(102), func, in0, in1);
+                            c.set_inv(in0, in0inv);
+                            c.set_inv(in1, in1inv);
+                            c.levelize();
+
+                            vector<int> raw(c.m_nwire);
+                            raw[in0] = in0val;
+                            raw[in1] = in1val;
+                            check_flat_gc(c, raw, scheme);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(GRBLTest, CorrectHalfGatesADD)
+{
+    int schemes[] = {GC_GRR3, GC_HALF_GATES};
+
+    for (int scheme : schemes) {
+        for (int in = 0; in < 8; in++) {
+            for (int inv = 0; inv < 8; inv++) {
+
+                // sum = a ^ b ^ cin, cout = (a & b) | ((a ^ b) & cin)
+                FlatCircuit c;
+                u32 a = c.add_wire(100);
+                u32 b = c.add_wire(101);
+                u32 cin = c.add_wire(103);
+                c.m_in_idx = {a, b, cin};
+                c.add_gate(c.add_wire(102), funcXOR, a, b);
+                c.add_gate(c.add_wire(104), funcXOR, c.add_wire(102), cin);
+                c.add_gate(c.add_wire(105), funcAND, a, b);
+                c.add_gate(c.add_wire(106), funcAND, c.add_wire(102), cin);
+                c.add_gate(c.add_wire(107), funcOR, c.add_wire(105), c.add_wire(106));
+                c.set_inv(a, inv & 1);
+                c.set_inv(b, (inv >> 1) & 1);
+                c.set_inv(cin, (inv >> 2) & 1);
+                c.levelize();
+
+                vector<int> raw(c.m_nwire);
+                raw[a] = in & 1;
+                raw[b] = (in >> 1) & 1;
+                raw[cin] = (in >> 2) & 1;
+                check_flat_gc(c, raw, scheme);
+            }
+        }
+    }
+}
+
+/**
+ * A random circuit of `depth` levels, each `width` gates wide, every gate
+ * reads two wires of the level below
+ *
+ */
+static void wide_flat_circ(FlatCircuit& c, vector<int>& raw, u32 width, u32 depth)
+{
+    vector<u32> prev, cur;
+    u32 id = 0;
+
+    for (u32 i = 0; i < width; i++) {
+        prev.push_back(c.add_wire(id++));
+        c.set_inv(prev.back(), rand() & 1);
+    }
+    c.m_in_idx = prev;
+
+    for (u32 l = 0; l < depth; l++) {
+        cur.clear();
+        for (u32 i = 0; i < width; i++) {
+            cur.push_back(c.add_wire(id++));
+            c.add_gate(cur.back(), rand() % 16, prev[rand() % width], prev[rand() % width]);
+        }
+        prev = cur;
+    }
+    c.levelize();
+
+    raw.assign(c.m_nwire, 0);
+    for (u32 idx : c.m_in_idx) {
+        raw[idx] = rand() & 1;
+    }
+}
+
+TEST_F(GRBLTest, ParallelFlatGarbling)
+{
+    int schemes[] = {GC_GRR3, GC_HALF_GATES};
+    u32 nthreads[] = {2, 4};
+
+    for (int scheme : schemes) {
+        for (u32 nthread : nthreads) {
+            FlatCircuit c;
+            vector<int> raw;
+            wide_flat_circ(c, raw, 3000, 4);
+            check_flat_gc(c, raw, scheme, nthread);
+        }
+    }
+}
+
+TEST_F(GRBLTest, ParallelFlatGarblingSameTables)
+{
+    int schemes[] = {GC_GRR3, GC_HALF_GATES};
+
+    for (int scheme : schemes) {
+        FlatCircuit c;
+        vector<int> raw;
+        wide_flat_circ(c, raw, 3000, 4);
+
+        Garbler parallel;
+        Garbler serial;
+        parallel.m_listen_sock = parallel.m_peer_sock = -1;
+        serial.m_listen_sock = serial.m_peer_sock = -1;
+
+        parallel.m_fc = c;
+        parallel.m_scheme = scheme;
+        parallel.m_nthread = 4;
+        parallel.garble_flat_circ();
+
+        // Same R and input labels, garbled one level at a time on this thread
+        serial.m_fc = c;
+        serial.m_scheme = scheme;
+        serial.m_fgc.alloc(c, scheme);
+        serial.m_fgc.m_R = parallel.m_fgc.m_R;
+        for (u32 idx : c.m_in_idx) {
+            serial.m_fgc.m_lbl[idx] = parallel.m_fgc.m_lbl[idx];
+        }
+        block* tbl = serial.m_fgc.m_tbl.data();
+        for (u32 l = 0; l < c.m_nlevel; l++) {
+            tbl = serial.garble_flat_gates(c.m_level_start[l], c.m_level_start[l + 1], tbl);
+        }
+
+        ASSERT_EQ(serial.m_fgc.m_tbl.size(), parallel.m_fgc.m_tbl.size());
+        for (size_t i = 0; i < serial.m_fgc.m_tbl.size(); i++) {
+            ASSERT_EQ(1, block_eq(serial.m_fgc.m_tbl[i], parallel.m_fgc.m_tbl[i]));
+        }
+        for (u32 w = 0; w < c.m_nwire; w++) {
+            ASSERT_EQ(1, block_eq(serial.m_fgc.m_lbl[w], parallel.m_fgc.m_lbl[w]));
+        }
+    }
+}
+
+TEST_F(GRBLTest, ReplicateFlatCircuit)
+{
+    FlatCircuit c;
+    FlatCircuit r;
+    vector<int> raw;
+    vector<int> rraw;
+    u32 n = 4;
+
+    wide_flat_circ(c, raw, 64, 3);
+    ASSERT_EQ(0, gashgc::replicate_circuit(c, n, r));
+    EXPECT_EQ(c.m_nlevel, r.m_nlevel);
+    EXPECT_EQ(n * c.m_ngate, r.m_ngate);
+    EXPECT_EQ(n * c.m_nnonxor, r.m_nnonxor);
+
+    // Every copy gets the same inputs as the original
+    rraw.assign(r.m_nwire, 0);
+    for (u32 k = 0; k < n; k++) {
+        for (u32 i = 0; i < c.m_nwire; i++) {
+            rraw[i + k * c.m_nwire] = raw[i];
+        }
+    }
+
+    check_flat_gc(c, raw, GC_HALF_GATES);
+    check_flat_gc(r, rraw, GC_HALF_GATES);
+
+    for (u32 k = 0; k < n; k++) {
+        for (u32 i = 0; i < c.m_nwire; i++) {
+            ASSERT_EQ(raw[i], rraw[i + k * c.m_nwire]);
+            ASSERT_EQ(c.m_wire_id[i] + k * c.m_wire_idx.size(), r.m_wire_id[i + k * c.m_nwire]);
+            ASSERT_EQ(c.get_inv(i), r.get_inv(i + k * c.m_nwire));
+        }
+    }
+}
+
 int main(int argc, char* argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -30,6 +30,7 @@
 #include "../../gc/util.hh"
 #include "../../gc/aes.hh"
 #include "../../gc/ot.hh"
+#include "../../gc/otpool.hh"
 #include "../../gc/garbler.hh"
 #include "../../gc/evaluator.hh"
 
@@ -43,22 +44,28 @@ using gashgc::aes_decrypt128;
 using gashgc::aes_encrypt128;
 using gashgc::AESkey;
 using gashgc::EGTT;
+using gashgc::FixedKeyAES;
 using gashgc::block2hex;
 using gashgc::block_eq;
 using gashgc::decrypt;
 using gashgc::encrypt;
 using gashgc::eval_bgate;
+using gashgc::split_bgate;
 using gashgc::get_lsb;
 using gashgc::new_tweak;
 using gashgc::random_block;
 using gashgc::set_lsb;
 using gashgc::xor_block;
 using gashgc::tcp_report;
+using gashgc::tcp_send_bytes;
+using gashgc::tcp_recv_bytes;
 using gashgc::find_n_replace;
 
 using gashgc::OTParty;
+using gashgc::OTPool;
 using gashgc::Garbler;
 using gashgc::Evaluator;
+using gashgc::FlatCircuit;
 
 typedef gashgc::GarbledCircuit GC;
 typedef gashgc::GarbledGate GG;
@@ -17,6 +17,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sys/wait.h>
 #include "../include/common.hh"
 
 #define nlbls      1000
@@ -62,11 +63,177 @@ TEST_F(OTTest, SendRcv) {
       EXPECT_EQ(1, block_eq(lbl, correct_lbl));
     }
 
+    // Report to the parent instead of running the remaining tests
+    _exit(HasFailure());
+
   } else{
     // Parent plays sender
     OTParty otp;
     EXPECT_EQ(0, otp.OTSend(s_ip, s_port, lbl0vec, lbl1vec));
 
+    int status;
+    wait(&status);
+    EXPECT_EQ(0, WEXITSTATUS(status));
+  }
+
+}
+
+TEST_F(OTTest, SendRcv64) {
+
+  vector<u64> m0(nlbls);
+  vector<u64> m1(nlbls);
+  vector<u8>  sel(nlbls);
+
+  for (int i = 0; i < nlbls; ++i) {
+    m0[i] = _mm_cvtsi128_si64(random_block());
+    m1[i] = _mm_cvtsi128_si64(random_block());
+    sel[i] = rand() % 2;
+  }
+
+  if (fork() == 0) {
+    // Child plays receiver
+    sleep(2.0);
+    OTParty     otp;
+    vector<u64> res(nlbls);
+
+    EXPECT_EQ(0, otp.OTRecv64(s_ip, s_port + 3, sel, [&](u32 off, const u64* msgs, u32 n) {
+      std::copy(msgs, msgs + n, res.begin() + off);
+    }));
+
+    for (int i = 0; i < nlbls; ++i) {
+      EXPECT_EQ(sel[i] == 0 ? m0[i] : m1[i], res[i]);
+    }
+
+    _exit(HasFailure());
+
+  } else {
+    // Parent plays sender
+    OTParty otp;
+    EXPECT_EQ(0, otp.OTSend64(s_ip, s_port + 3, m0, m1));
+
+    int status;
+    wait(&status);
+    EXPECT_EQ(0, WEXITSTATUS(status));
+  }
+
+}
+
+TEST_F(OTTest, CorrelatedSendRcv) {
+
+  IdSelMap    selmap;
+  IdBlockMap  res_idlbl_map;
+  BlockVec    lbl0vec(nlbls);
+  block       R = random_block();
+  int         fd[2];
+
+  for (int i = 0; i < nlbls; ++i) {
+    selmap.emplace(i, rand() % 2);
+  }
+
+  // Side channel for the labels the sender ends up with
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fd));
+
+  if (fork() == 0) {
+    // Child plays receiver
+    sleep(2.0);
+    OTParty otp;
+    EXPECT_EQ(0, otp.COTRecv(s_ip, s_port + 2, selmap, res_idlbl_map));
+
+    close(fd[1]);
+    ASSERT_EQ(0, tcp_recv_bytes(fd[0], (char*)lbl0vec.data(), nlbls * LABELSIZE));
+
+    // Every received label is L0 or L0 ^ R
+    for (auto it = selmap.begin(); it != selmap.end(); ++it) {
+      block correct_lbl = it->second == 0 ? lbl0vec[it->first] : xor_block(lbl0vec[it->first], R);
+      ASSERT_TRUE(res_idlbl_map.find(it->first) != res_idlbl_map.end());
+      EXPECT_EQ(1, block_eq(res_idlbl_map.find(it->first)->second, correct_lbl));
+    }
+
+    _exit(HasFailure());
+
+  } else {
+    // Parent plays sender
+    OTParty otp;
+    EXPECT_EQ(0, otp.COTSend(s_ip, s_port + 2, R, nlbls, lbl0vec));
+
+    close(fd[0]);
+    ASSERT_EQ(0, tcp_send_bytes(fd[1], (char*)lbl0vec.data(), nlbls * LABELSIZE));
+
+    int status;
+    wait(&status);
+    EXPECT_EQ(0, WEXITSTATUS(status));
+  }
+
+}
+
+TEST_F(OTTest, RandomOTPool) {
+
+  u32         n = 300;
+  int         fd[2];
+
+  // Side channel for the sender's messages
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fd));
+
+  if (fork() == 0) {
+    // Child plays receiver, in two takes so that the pool refills between them
+    sleep(2.0);
+    {
+      OTParty     otp;
+      OTPool      pool(&otp, 1, s_ip, s_port + 1);
+      vector<int> c;
+      BlockVec    mc;
+      BlockVec    m0(n);
+      BlockVec    m1(n);
+
+      pool.m_low = pool.m_batch = n / 2;
+      pool.fill(n / 2);
+      ASSERT_EQ(0, pool.take(n / 2, c, mc));
+      vector<int> c1;
+      BlockVec    mc1;
+      ASSERT_EQ(0, pool.take(n / 2, c1, mc1));
+      c.insert(c.end(), c1.begin(), c1.end());
+      mc.insert(mc.end(), mc1.begin(), mc1.end());
+
+      // The sender's random messages, to check the chosen ones against
+      close(fd[1]);
+      ASSERT_EQ(0, tcp_recv_bytes(fd[0], (char*)m0.data(), n * LABELSIZE));
+      ASSERT_EQ(0, tcp_recv_bytes(fd[0], (char*)m1.data(), n * LABELSIZE));
+
+      for (u32 i = 0; i < n; i++) {
+        EXPECT_EQ(1, block_eq(mc[i], c[i] == 0 ? m0[i] : m1[i]));
+      }
+      EXPECT_EQ(n, pool.stats().m_ntaken);
+
+      // The last take queued a refill, both pools run it before they stop
+    }
+
+    _exit(HasFailure());
+
+  } else {
+    // Parent plays sender, with the same sequence of fills and takes
+    {
+      OTParty     otp;
+      OTPool      pool(&otp, 0, s_ip, s_port + 1);
+      BlockVec    m0;
+      BlockVec    m1;
+      BlockVec    m0_1;
+      BlockVec    m1_1;
+
+      pool.m_low = pool.m_batch = n / 2;
+      pool.fill(n / 2);
+      ASSERT_EQ(0, pool.take(n / 2, m0, m1));
+      ASSERT_EQ(0, pool.take(n / 2, m0_1, m1_1));
+      m0.insert(m0.end(), m0_1.begin(), m0_1.end());
+      m1.insert(m1.end(), m1_1.begin(), m1_1.end());
+
+      close(fd[0]);
+      ASSERT_EQ(0, tcp_send_bytes(fd[1], (char*)m0.data(), n * LABELSIZE));
+      ASSERT_EQ(0, tcp_send_bytes(fd[1], (char*)m1.data(), n * LABELSIZE));
+    }
+
+    int status;
+    wait(&status);
+    EXPECT_EQ(0, WEXITSTATUS(status));
   }
 
 }
@@ -110,6 +110,72 @@ TEST_F(TCPTest, SendRecv) {
   }
 }
 
+TEST_F(TCPTest, SendRecvMpz) {
+
+  int sv[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+  /**
+   * Single values, sent exactly
+   *
+   */
+  {
+    mpz_class vals[] = { 0, 1, -1, 255, 256, -1000000007 };
+    mpz_class big = 1;
+    mpz_class ret;
+
+    big <<= 200;
+    big -= 3;
+
+    for (mpz_class& v : vals) {
+      EXPECT_EQ(0, gashgc::tcp_send_mpz(sv[0], v));
+      EXPECT_EQ(0, gashgc::tcp_recv_mpz(sv[1], ret));
+      EXPECT_EQ(v, ret);
+    }
+
+    EXPECT_EQ(0, gashgc::tcp_send_mpz(sv[0], big));
+    EXPECT_EQ(0, gashgc::tcp_recv_mpz(sv[1], ret));
+    EXPECT_EQ(big, ret);
+  }
+
+  /**
+   * Vectors of 64-bit ring elements
+   *
+   */
+  {
+    vector<mpz_class> vec = { 0, 1, -1, 12345, -12345 };
+    vector<mpz_class> ret;
+    mpz_class ring = 1;
+
+    ring <<= 64;
+
+    EXPECT_EQ(0, gashgc::tcp_send_mpz_vec(sv[0], vec, 64));
+    EXPECT_EQ(0, gashgc::tcp_recv_mpz_vec(sv[1], ret, 64));
+    ASSERT_EQ(vec.size(), ret.size());
+    for (u32 i = 0; i < vec.size(); i++) {
+      mpz_class expected = vec[i] < 0 ? vec[i] + ring : vec[i];
+      EXPECT_EQ(expected, ret[i]);
+    }
+
+    vec.clear();
+    EXPECT_EQ(0, gashgc::tcp_send_mpz_vec(sv[0], vec, 64));
+    EXPECT_EQ(0, gashgc::tcp_recv_mpz_vec(sv[1], ret, 64));
+    EXPECT_EQ(0u, ret.size());
+  }
+
+  {
+    vector<u64> vec = { 0, 1, 0xffffffffffffffffULL, 0x0123456789abcdefULL };
+    vector<u64> ret;
+
+    EXPECT_EQ(0, gashgc::tcp_send_u64_vec(sv[0], vec));
+    EXPECT_EQ(0, gashgc::tcp_recv_u64_vec(sv[1], ret));
+    EXPECT_EQ(vec, ret);
+  }
+
+  close(sv[0]);
+  close(sv[1]);
+}
+
 int main(int argc, char* argv[])
 {
   ::testing::InitGoogleTest(&argc, argv);